@@ -0,0 +1,644 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// Every case runs for this time, rounds of warmup of ping-pong go before it
+#define DURATION_MS 100
+#define WARMUP_ROUNDS 16
+// Limit of recorded round trips of every pair
+#define MAX_SAMPLES (1 << 16)
+// Receive gives up after this time, lost datagram or stalled peer ends case
+#define RECEIVE_TIMEOUT_MS 1000
+// Buffers of datagram sockets, size of unix datagram is limited by send buffer
+#define DATAGRAM_BUFFER (4 << 20)
+// Largest payload of one UDP datagram: 65535 - IP header (IPv4 only) - UDP header
+#define UDP_MAX_MESSAGE 65507
+#define UDP6_MAX_MESSAGE 65527
+#define UNIX_DATAGRAM_OVERHEAD 32
+
+// Sockets of one kind, every pair of case uses own sockets
+struct transport {
+    const char *name;
+    int family;
+    int type;
+};
+
+enum test_kind {
+    TEST_PING_PONG,
+    TEST_THROUGHPUT
+};
+
+// One point of sweep
+struct bench_case {
+    const struct transport *transport;
+    enum test_kind kind;
+    size_t size;
+    int concurrency;
+    pthread_barrier_t barrier;
+};
+
+// Sender and receiver of one pair and their results
+struct pair_state {
+    struct bench_case *bench_case;
+    pthread_t client_thread;
+    pthread_t server_thread;
+    int client_fd;
+    int server_fd;
+    char *client_buffer;
+    char *server_buffer;
+    uint64_t *samples;
+    size_t sample_count;
+    uint64_t start_ns;
+    uint64_t last_ns;
+    uint64_t sent_messages;
+    uint64_t received_bytes;
+    int failed;
+};
+
+const struct transport transports[] = {
+        { "unix_stream", AF_UNIX, SOCK_STREAM },
+        { "unix_dgram", AF_UNIX, SOCK_DGRAM },
+        { "unix_seqpacket", AF_UNIX, SOCK_SEQPACKET },
+        { "inet_stream", AF_INET, SOCK_STREAM },
+        { "inet_dgram", AF_INET, SOCK_DGRAM },
+        { "inet6_stream", AF_INET6, SOCK_STREAM },
+        { "inet6_dgram", AF_INET6, SOCK_DGRAM }
+};
+
+const size_t sizes[] = { 64, 256, 1024, 4096, 16384, 65536, 262144, 1048576 };
+
+const int concurrencies[] = { 1, 4, 16 };
+
+const char *kind_names[] = { "ping_pong", "throughput" };
+
+const char *family_name(int family) {
+    return family == AF_UNIX ? "unix" : family == AF_INET ? "inet" : "inet6";
+}
+
+const char *type_name(int type) {
+    return type == SOCK_STREAM ? "stream" : type == SOCK_DGRAM ? "dgram" : "seqpacket";
+}
+
+uint64_t now_ns() {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+int compare_sample(const void* left, const void* right) {
+    uint64_t a = *(const uint64_t *) left, b = *(const uint64_t *) right;
+    return (a > b) - (a < b);
+}
+
+// Stream carries message in parts, every other type carries it whole or not at all
+int send_message(int fd, int type, const char* buffer, size_t size) {
+    size_t sent = 0;
+
+    do {
+        ssize_t result = send(fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+        if (result == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (type != SOCK_STREAM && (size_t) result != size) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+        sent += (size_t) result;
+    } while (sent < size);
+
+    return 0;
+}
+
+// Returns size of message, 0 - end of stream or empty datagram of end, -1 - error or timeout
+ssize_t receive_message(int fd, int type, char* buffer, size_t size) {
+    ssize_t result;
+
+    do {
+        result = recv(fd, buffer, size, type == SOCK_STREAM ? MSG_WAITALL : 0);
+    } while (result == -1 && errno == EINTR);
+
+    // Timeout of MSG_WAITALL returns part of message
+    if (type == SOCK_STREAM && result > 0 && (size_t) result != size) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    return result;
+}
+
+// End of data for receiver of pair, stream is closed for writes, other types get empty message
+void send_end(int fd, int type) {
+    if (type == SOCK_STREAM) {
+        shutdown(fd, SHUT_WR);
+    } else {
+        // UDP may drop it, receiver then ends by timeout
+        for (int i = 0; i < 3; i++) {
+            send(fd, NULL, 0, MSG_NOSIGNAL);
+        }
+    }
+}
+
+int tune_socket(int fd, const struct transport* transport) {
+    // Declaration and assign options
+    struct timeval timeout = {
+            .tv_sec = RECEIVE_TIMEOUT_MS / 1000, .tv_usec = (RECEIVE_TIMEOUT_MS % 1000) * 1000
+    };
+    int buffer = DATAGRAM_BUFFER, enable = 1;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == -1) {
+        return -1;
+    }
+
+    if (transport->type == SOCK_STREAM) {
+        // Without it last part of message waits for acknowledgement of previous one
+        if (transport->family != AF_UNIX
+            && setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable)) == -1) {
+            return -1;
+        }
+        // Buffers of stream stay default, fixed size turns off autotuning of TCP
+        return 0;
+    }
+
+    // Kernel caps both by net.core.wmem_max and net.core.rmem_max
+    if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer)) == -1
+        || setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer)) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Largest message which one send of this socket carries whole
+size_t message_limit(int fd, const struct transport* transport) {
+    int buffer = 0;
+    socklen_t buffer_size = sizeof(buffer);
+
+    if (transport->type == SOCK_STREAM) {
+        return SIZE_MAX;
+    }
+
+    if (transport->family == AF_INET) {
+        return UDP_MAX_MESSAGE;
+    }
+
+    if (transport->family == AF_INET6) {
+        return UDP6_MAX_MESSAGE;
+    }
+
+    // Unix datagram and sequenced packet have to fit in send buffer
+    if (getsockopt(fd, SOL_SOCKET, SO_SNDBUF, &buffer, &buffer_size) == -1 || buffer <= UNIX_DATAGRAM_OVERHEAD) {
+        return 0;
+    }
+
+    return (size_t) buffer - UNIX_DATAGRAM_OVERHEAD;
+}
+
+// Bind to loopback with port chosen by kernel, unix socket gets free abstract address
+int bind_loopback(int fd, int family) {
+    // Declaration and assign address
+    struct sockaddr_storage address = {0};
+    socklen_t address_size = sizeof(sa_family_t);
+
+    address.ss_family = (sa_family_t) family;
+
+    if (family == AF_INET) {
+        ((struct sockaddr_in *) &address)->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address_size = sizeof(struct sockaddr_in);
+    } else if (family == AF_INET6) {
+        ((struct sockaddr_in6 *) &address)->sin6_addr = in6addr_loopback;
+        address_size = sizeof(struct sockaddr_in6);
+    }
+
+    return bind(fd, (struct sockaddr *) &address, address_size);
+}
+
+int open_socket(const struct transport* transport) {
+    int fd = socket(transport->family, transport->type, 0);
+    if (fd == -1) {
+        return -1;
+    }
+
+    if (tune_socket(fd, transport) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// Connected sockets of pair, stream and sequenced packet pair comes through listener
+int open_pair(const struct transport* transport, int listener, int* client_fd, int* server_fd) {
+    // Declaration and assign addresses
+    struct sockaddr_storage client_address = {0}, server_address = {0};
+    socklen_t client_address_size = sizeof(client_address), server_address_size = sizeof(server_address);
+
+    *client_fd = open_socket(transport);
+    if (*client_fd == -1) {
+        return -1;
+    }
+
+    if (transport->type != SOCK_DGRAM) {
+        if (getsockname(listener, (struct sockaddr *) &server_address, &server_address_size) == -1
+            || connect(*client_fd, (struct sockaddr *) &server_address, server_address_size) == -1) {
+            close(*client_fd);
+            return -1;
+        }
+
+        *server_fd = accept(listener, NULL, NULL);
+        if (*server_fd == -1 || tune_socket(*server_fd, transport) == -1) {
+            close(*client_fd);
+            return -1;
+        }
+
+        return 0;
+    }
+
+    *server_fd = open_socket(transport);
+    if (*server_fd == -1) {
+        close(*client_fd);
+        return -1;
+    }
+
+    if (bind_loopback(*client_fd, transport->family) == -1
+        || bind_loopback(*server_fd, transport->family) == -1
+        || getsockname(*client_fd, (struct sockaddr *) &client_address, &client_address_size) == -1
+        || getsockname(*server_fd, (struct sockaddr *) &server_address, &server_address_size) == -1
+        || connect(*client_fd, (struct sockaddr *) &server_address, server_address_size) == -1
+        || connect(*server_fd, (struct sockaddr *) &client_address, client_address_size) == -1) {
+        close(*client_fd);
+        close(*server_fd);
+        return -1;
+    }
+
+    return 0;
+}
+
+int open_listener(const struct transport* transport) {
+    int fd = open_socket(transport);
+    if (fd == -1) {
+        return -1;
+    }
+
+    if (bind_loopback(fd, transport->family) == -1 || listen(fd, SOMAXCONN) == -1) {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// Sends message and waits for its echo, time of every round trip is sample
+void* ping_pong_client(void* argument) {
+    struct pair_state *pair = argument;
+    int type = pair->bench_case->transport->type;
+    size_t size = pair->bench_case->size;
+
+    pthread_barrier_wait(&pair->bench_case->barrier);
+
+    // Rounds of warmup are not limited by duration, large messages get them too
+    for (int round = 0; round < WARMUP_ROUNDS && !pair->failed; round++) {
+        if (send_message(pair->client_fd, type, pair->client_buffer, size) == -1
+            || receive_message(pair->client_fd, type, pair->client_buffer, size) != (ssize_t) size) {
+            pair->failed = 1;
+        }
+    }
+
+    pair->start_ns = now_ns();
+    uint64_t end_ns = pair->start_ns + (uint64_t) DURATION_MS * 1000000ULL;
+
+    for (uint64_t round_ns = pair->start_ns; round_ns < end_ns && !pair->failed;) {
+        if (send_message(pair->client_fd, type, pair->client_buffer, size) == -1
+            || receive_message(pair->client_fd, type, pair->client_buffer, size) != (ssize_t) size) {
+            pair->failed = 1;
+            break;
+        }
+
+        uint64_t reply_ns = now_ns();
+
+        if (pair->sample_count < MAX_SAMPLES) {
+            pair->samples[pair->sample_count++] = reply_ns - round_ns;
+        }
+
+        round_ns = reply_ns;
+    }
+
+    send_end(pair->client_fd, type);
+
+    return NULL;
+}
+
+void* ping_pong_server(void* argument) {
+    struct pair_state *pair = argument;
+    int type = pair->bench_case->transport->type;
+    size_t size = pair->bench_case->size;
+
+    pthread_barrier_wait(&pair->bench_case->barrier);
+
+    for (;;) {
+        ssize_t received = receive_message(pair->server_fd, type, pair->server_buffer, size);
+        if (received <= 0 || send_message(pair->server_fd, type, pair->server_buffer, (size_t) received) == -1) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+// Sends messages one after another without waiting for receiver
+void* throughput_client(void* argument) {
+    struct pair_state *pair = argument;
+    int type = pair->bench_case->transport->type;
+    size_t size = pair->bench_case->size;
+
+    pthread_barrier_wait(&pair->bench_case->barrier);
+
+    pair->start_ns = now_ns();
+    uint64_t end_ns = pair->start_ns + (uint64_t) DURATION_MS * 1000000ULL;
+
+    while (now_ns() < end_ns) {
+        if (send_message(pair->client_fd, type, pair->client_buffer, size) == -1) {
+            // UDP reports drop of previous datagram at receiver with error of next send
+            if (errno == ECONNREFUSED) {
+                continue;
+            }
+            pair->failed = 1;
+            break;
+        }
+        ++pair->sent_messages;
+    }
+
+    send_end(pair->client_fd, type);
+
+    return NULL;
+}
+
+// Counts received bytes until end, time of last data ends measurement
+void* throughput_server(void* argument) {
+    struct pair_state *pair = argument;
+    size_t size = pair->bench_case->size;
+
+    pthread_barrier_wait(&pair->bench_case->barrier);
+
+    for (;;) {
+        ssize_t received;
+
+        do {
+            received = recv(pair->server_fd, pair->server_buffer, size, 0);
+        } while (received == -1 && errno == EINTR);
+
+        if (received <= 0) {
+            break;
+        }
+
+        pair->received_bytes += (uint64_t) received;
+        pair->last_ns = now_ns();
+    }
+
+    return NULL;
+}
+
+void print_percentiles(FILE* output, uint64_t* samples, size_t count) {
+    qsort(samples, count, sizeof(uint64_t), compare_sample);
+
+    double total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += (double) samples[i];
+    }
+
+    fprintf(output, ", \"rtt_us\": {\"mean\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, "
+                    "\"p999\": %.3f, \"max\": %.3f}",
+            total / (double) count / 1e3,
+            (double) samples[count / 2] / 1e3,
+            (double) samples[count * 90 / 100] / 1e3,
+            (double) samples[count * 99 / 100] / 1e3,
+            (double) samples[count * 999 / 1000] / 1e3,
+            (double) samples[count - 1] / 1e3);
+}
+
+// Run one point of sweep with own sockets and threads, write it as one JSON object
+void run_case(FILE* output, struct bench_case* bench_case) {
+    // Declaration and assign pairs
+    struct pair_state *pairs = calloc((size_t) bench_case->concurrency, sizeof(struct pair_state));
+    int listener = -1, opened = 0;
+    const char *error = NULL;
+    size_t limit = SIZE_MAX;
+
+    if (pairs == NULL) {
+        perror("\n\ncalloc");
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(output, "    {\"transport\": \"%s\", \"family\": \"%s\", \"type\": \"%s\", \"test\": \"%s\", "
+                    "\"size\": %zu, \"concurrency\": %d",
+            bench_case->transport->name, family_name(bench_case->transport->family),
+            type_name(bench_case->transport->type), kind_names[bench_case->kind],
+            bench_case->size, bench_case->concurrency);
+
+    if (bench_case->transport->type != SOCK_DGRAM) {
+        listener = open_listener(bench_case->transport);
+        if (listener == -1) {
+            error = strerror(errno);
+        }
+    }
+
+    for (; error == NULL && opened < bench_case->concurrency; opened++) {
+        struct pair_state *pair = &pairs[opened];
+
+        if (open_pair(bench_case->transport, listener, &pair->client_fd, &pair->server_fd) == -1) {
+            error = strerror(errno);
+            break;
+        }
+
+        limit = message_limit(pair->client_fd, bench_case->transport);
+
+        pair->bench_case = bench_case;
+        pair->client_buffer = malloc(bench_case->size);
+        pair->server_buffer = malloc(bench_case->size);
+        pair->samples = bench_case->kind == TEST_PING_PONG ? malloc(MAX_SAMPLES * sizeof(uint64_t)) : NULL;
+
+        if (pair->client_buffer == NULL || pair->server_buffer == NULL
+            || (bench_case->kind == TEST_PING_PONG && pair->samples == NULL)) {
+            perror("\n\nmalloc");
+            exit(EXIT_FAILURE);
+        }
+
+        memset(pair->client_buffer, 'b', bench_case->size);
+    }
+
+    if (error == NULL && bench_case->size > limit) {
+        error = "message exceeds limit of one datagram";
+        fprintf(output, ", \"limit\": %zu", limit);
+    }
+
+    if (error == NULL) {
+        void* (*client)(void*) = bench_case->kind == TEST_PING_PONG ? ping_pong_client : throughput_client;
+        void* (*server)(void*) = bench_case->kind == TEST_PING_PONG ? ping_pong_server : throughput_server;
+
+        pthread_barrier_init(&bench_case->barrier, NULL, (unsigned) bench_case->concurrency * 2);
+
+        for (int i = 0; i < bench_case->concurrency; i++) {
+            if (pthread_create(&pairs[i].server_thread, NULL, server, &pairs[i]) != 0
+                || pthread_create(&pairs[i].client_thread, NULL, client, &pairs[i]) != 0) {
+                fprintf(stderr, "\n\npthread_create: failed\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        for (int i = 0; i < bench_case->concurrency; i++) {
+            pthread_join(pairs[i].client_thread, NULL);
+            pthread_join(pairs[i].server_thread, NULL);
+        }
+
+        pthread_barrier_destroy(&bench_case->barrier);
+    }
+
+    if (error != NULL) {
+        fprintf(output, ", \"error\": \"%s\"", error);
+    } else {
+        int failed = 0;
+        uint64_t start_ns = UINT64_MAX, last_ns = 0, sent_messages = 0, received_bytes = 0;
+        size_t sample_count = 0;
+        uint64_t *samples = NULL;
+
+        if (bench_case->kind == TEST_PING_PONG) {
+            samples = malloc((size_t) bench_case->concurrency * MAX_SAMPLES * sizeof(uint64_t));
+            if (samples == NULL) {
+                perror("\n\nmalloc");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        for (int i = 0; i < bench_case->concurrency; i++) {
+            failed += pairs[i].failed;
+            start_ns = pairs[i].start_ns < start_ns ? pairs[i].start_ns : start_ns;
+            last_ns = pairs[i].last_ns > last_ns ? pairs[i].last_ns : last_ns;
+            sent_messages += pairs[i].sent_messages;
+            received_bytes += pairs[i].received_bytes;
+
+            // Pack samples of pairs together for percentiles
+            if (bench_case->kind == TEST_PING_PONG) {
+                memmove(samples + sample_count, pairs[i].samples, pairs[i].sample_count * sizeof(uint64_t));
+                sample_count += pairs[i].sample_count;
+            }
+        }
+
+        fprintf(output, ", \"failed_pairs\": %d", failed);
+
+        if (bench_case->kind == TEST_PING_PONG) {
+            fprintf(output, ", \"round_trips\": %zu", sample_count);
+            if (sample_count != 0) {
+                print_percentiles(output, samples, sample_count);
+            }
+        } else {
+            double elapsed_s = last_ns > start_ns ? (double) (last_ns - start_ns) / 1e9 : 0.0;
+            uint64_t received_messages = received_bytes / bench_case->size;
+
+            fprintf(output, ", \"sent_messages\": %lu, \"received_messages\": %lu, \"received_bytes\": %lu, "
+                            "\"messages_per_s\": %.0f, \"mib_per_s\": %.1f",
+                    (unsigned long) sent_messages, (unsigned long) received_messages,
+                    (unsigned long) received_bytes,
+                    elapsed_s > 0 ? (double) received_messages / elapsed_s : 0.0,
+                    elapsed_s > 0 ? (double) received_bytes / 1048576.0 / elapsed_s : 0.0);
+        }
+
+        free(samples);
+    }
+
+    fprintf(output, "}");
+
+    for (int i = 0; i < opened; i++) {
+        close(pairs[i].client_fd);
+        close(pairs[i].server_fd);
+        free(pairs[i].client_buffer);
+        free(pairs[i].server_buffer);
+        free(pairs[i].samples);
+    }
+
+    if (listener != -1) {
+        close(listener);
+    }
+
+    free(pairs);
+}
+
+int main(int argc, char* argv[]) {
+    // Declaration and assign output
+    FILE *output = stdout;
+    int first = 1;
+
+    if (argc > 2) {
+        fprintf(stderr, "Usage: %s [output.json]\n", argv[0]);
+        return 1;
+    }
+
+    if (argc == 2) {
+        output = fopen(argv[1], "w");
+        if (output == NULL) {
+            perror("\n\nfopen");
+            return 1;
+        }
+    }
+
+    fprintf(output, "{\n  \"duration_ms\": %d,\n  \"results\": [\n", DURATION_MS);
+
+    for (size_t t = 0; t < sizeof(transports) / sizeof(transports[0]); t++) {
+        for (int kind = TEST_PING_PONG; kind <= TEST_THROUGHPUT; kind++) {
+            for (size_t c = 0; c < sizeof(concurrencies) / sizeof(concurrencies[0]); c++) {
+                for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+                    struct bench_case bench_case = {
+                            .transport = &transports[t],
+                            .kind = (enum test_kind) kind,
+                            .size = sizes[s],
+                            .concurrency = concurrencies[c]
+                    };
+
+                    fprintf(stderr, "%s %s %zu B x%d\n", transports[t].name, kind_names[kind],
+                            sizes[s], concurrencies[c]);
+
+                    fprintf(output, first ? "" : ",\n");
+                    first = 0;
+
+                    run_case(output, &bench_case);
+                    fflush(output);
+                }
+            }
+        }
+    }
+
+    fprintf(output, "\n  ]\n}\n");
+
+    if (output != stdout) {
+        fclose(output);
+    }
+
+    return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "histogram.h"
+
+// Highest bit above exact range selects power of two, next HISTOGRAM_SUB_BUCKET_BITS bits select sub-bucket
+static int histogram_index(uint64_t value) {
+    int shift = value < 2 * HISTOGRAM_SUB_BUCKETS
+                ? 0 : (63 - __builtin_clzll(value)) - HISTOGRAM_SUB_BUCKET_BITS;
+
+    return shift * HISTOGRAM_SUB_BUCKETS + (int) (value >> shift);
+}
+
+static uint64_t histogram_lowest_value(int index) {
+    int shift = index < 2 * HISTOGRAM_SUB_BUCKETS ? 0 : index / HISTOGRAM_SUB_BUCKETS - 1;
+
+    return (uint64_t) (index - shift * HISTOGRAM_SUB_BUCKETS) << shift;
+}
+
+// Last bucket ends at UINT64_MAX, wrap of unsigned shift gives exactly it
+static uint64_t histogram_highest_value(int index) {
+    int shift = index < 2 * HISTOGRAM_SUB_BUCKETS ? 0 : index / HISTOGRAM_SUB_BUCKETS - 1;
+
+    return (((uint64_t) (index - shift * HISTOGRAM_SUB_BUCKETS) + 1) << shift) - 1;
+}
+
+struct histogram* histogram_create(void) {
+    struct histogram *histogram = calloc(1, sizeof(struct histogram));
+    if (histogram == NULL) {
+        return NULL;
+    }
+
+    histogram_reset(histogram);
+
+    return histogram;
+}
+
+void histogram_reset(struct histogram* histogram) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        atomic_store_explicit(&histogram->counts[i], 0, memory_order_relaxed);
+    }
+
+    atomic_store_explicit(&histogram->total, 0, memory_order_relaxed);
+    atomic_store_explicit(&histogram->min, UINT64_MAX, memory_order_relaxed);
+    atomic_store_explicit(&histogram->max, 0, memory_order_relaxed);
+}
+
+// Counters are independent, none of them orders other memory, relaxed order is enough
+void histogram_record(struct histogram* histogram, uint64_t value) {
+    atomic_fetch_add_explicit(&histogram->counts[histogram_index(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->total, 1, memory_order_relaxed);
+
+    uint64_t min = atomic_load_explicit(&histogram->min, memory_order_relaxed);
+    while (value < min && !atomic_compare_exchange_weak_explicit(
+            &histogram->min, &min, value, memory_order_relaxed, memory_order_relaxed)) {}
+
+    uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    while (value > max && !atomic_compare_exchange_weak_explicit(
+            &histogram->max, &max, value, memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+void histogram_merge(struct histogram* into, const struct histogram* from) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        uint64_t count = atomic_load_explicit(&from->counts[i], memory_order_relaxed);
+        if (count != 0) {
+            atomic_fetch_add_explicit(&into->counts[i], count, memory_order_relaxed);
+        }
+    }
+
+    atomic_fetch_add_explicit(&into->total, atomic_load_explicit(&from->total, memory_order_relaxed),
+                              memory_order_relaxed);
+
+    uint64_t from_min = atomic_load_explicit(&from->min, memory_order_relaxed);
+    uint64_t min = atomic_load_explicit(&into->min, memory_order_relaxed);
+    while (from_min < min && !atomic_compare_exchange_weak_explicit(
+            &into->min, &min, from_min, memory_order_relaxed, memory_order_relaxed)) {}
+
+    uint64_t from_max = atomic_load_explicit(&from->max, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&into->max, memory_order_relaxed);
+    while (from_max > max && !atomic_compare_exchange_weak_explicit(
+            &into->max, &max, from_max, memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+uint64_t histogram_count(const struct histogram* histogram) {
+    return atomic_load_explicit(&histogram->total, memory_order_relaxed);
+}
+
+uint64_t histogram_percentile(const struct histogram* histogram, double percentile) {
+    uint64_t total = histogram_count(histogram), cumulative = 0;
+    uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+
+    if (total == 0) {
+        return 0;
+    }
+
+    // Rank of value, at least first one
+    double exact = percentile / 100.0 * (double) total;
+    uint64_t rank = (uint64_t) exact;
+    if ((double) rank < exact) {
+        ++rank;
+    }
+    rank = rank == 0 ? 1 : rank > total ? total : rank;
+
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        cumulative += atomic_load_explicit(&histogram->counts[i], memory_order_relaxed);
+        if (cumulative >= rank) {
+            uint64_t value = histogram_highest_value(i);
+            return value < max ? value : max;
+        }
+    }
+
+    // Values recorded during walk are not in total yet
+    return max;
+}
+
+void histogram_print(const struct histogram* histogram, const char* label, double scale, FILE* output) {
+    uint64_t total = histogram_count(histogram);
+
+    if (total == 0) {
+        fprintf(output, "%s: count 0\n", label);
+        return;
+    }
+
+    fprintf(output, "%s: count %lu, min %.3f, p50 %.3f, p99 %.3f, p99.9 %.3f, max %.3f\n",
+            label, (unsigned long) total,
+            (double) atomic_load_explicit(&histogram->min, memory_order_relaxed) / scale,
+            (double) histogram_percentile(histogram, 50.0) / scale,
+            (double) histogram_percentile(histogram, 99.0) / scale,
+            (double) histogram_percentile(histogram, 99.9) / scale,
+            (double) atomic_load_explicit(&histogram->max, memory_order_relaxed) / scale);
+}
+
+int histogram_export(const struct histogram* histogram, const char* path, double scale) {
+    // Declaration and assign totals of distribution
+    uint64_t total = histogram_count(histogram), cumulative = 0;
+    uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    double sum = 0.0, square_sum = 0.0;
+
+    FILE *output = fopen(path, "w");
+    if (output == NULL) {
+        return -1;
+    }
+
+    fprintf(output, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+
+    for (int i = 0; i < HISTOGRAM_BUCKETS && total != 0; i++) {
+        uint64_t count = atomic_load_explicit(&histogram->counts[i], memory_order_relaxed);
+        if (count == 0) {
+            continue;
+        }
+
+        uint64_t highest = histogram_highest_value(i);
+        double middle = ((double) histogram_lowest_value(i) + (double) (highest < max ? highest : max)) / 2.0;
+
+        cumulative += count;
+        sum += middle * (double) count;
+        square_sum += middle * middle * (double) count;
+
+        // One row for every bucket with values, percentile of it is share of values up to its end
+        double share = cumulative >= total ? 1.0 : (double) cumulative / (double) total;
+        if (share < 1.0) {
+            fprintf(output, "%12.3f %14.12f %10lu %14.2f\n", (double) (highest < max ? highest : max) / scale,
+                    share, (unsigned long) cumulative, 1.0 / (1.0 - share));
+        } else {
+            fprintf(output, "%12.3f %14.12f %10lu\n", (double) (highest < max ? highest : max) / scale,
+                    share, (unsigned long) cumulative);
+        }
+    }
+
+    double mean = total != 0 ? sum / (double) total : 0.0;
+    double deviation = total != 0 ? sqrt(fmax(square_sum / (double) total - mean * mean, 0.0)) : 0.0;
+
+    fprintf(output, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", mean / scale, deviation / scale);
+    fprintf(output, "#[Max     = %12.3f, Total count    = %12lu]\n", (double) max / scale, (unsigned long) total);
+    fprintf(output, "#[Buckets = %12d, SubBuckets     = %12d]\n",
+            HISTOGRAM_BUCKETS / HISTOGRAM_SUB_BUCKETS, HISTOGRAM_SUB_BUCKETS);
+
+    if (fclose(output) == EOF) {
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+// Values below 2 * HISTOGRAM_SUB_BUCKETS are exact, above them error of value is below 1 / HISTOGRAM_SUB_BUCKETS
+#define HISTOGRAM_SUB_BUCKET_BITS 7
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+// Every power of two above exact range adds HISTOGRAM_SUB_BUCKETS buckets, whole uint64_t range fits
+#define HISTOGRAM_BUCKETS ((65 - HISTOGRAM_SUB_BUCKET_BITS) * HISTOGRAM_SUB_BUCKETS)
+
+// Log-linear histogram of fixed size, any thread records into it without locks
+struct histogram {
+    _Atomic uint64_t counts[HISTOGRAM_BUCKETS];
+    _Atomic uint64_t total;
+    _Atomic uint64_t min;
+    _Atomic uint64_t max;
+};
+
+// Allocate empty histogram, release it with free()
+struct histogram* histogram_create(void);
+
+// Empty histogram, only when nobody records into it
+void histogram_reset(struct histogram* histogram);
+
+void histogram_record(struct histogram* histogram, uint64_t value);
+
+// Add all values of one histogram to another, histogram of every thread goes to common one
+void histogram_merge(struct histogram* into, const struct histogram* from);
+
+uint64_t histogram_count(const struct histogram* histogram);
+
+// Highest value of bucket which holds this percentile (0 - 100), 0 if histogram is empty
+uint64_t histogram_percentile(const struct histogram* histogram, double percentile);
+
+// One line with count, p50, p99, p99.9 and max, values are divided by scale
+void histogram_print(const struct histogram* histogram, const char* label, double scale, FILE* output);
+
+// Percentile distribution in format of HdrHistogram (.hgrm), values are divided by scale
+int histogram_export(const struct histogram* histogram, const char* path, double scale);
+
+#endif // HISTOGRAM_H
@@ -0,0 +1,252 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#define BUFF_SIZE 65535
+// Stop draining when socket is idle for this time after the first datagram
+#define IDLE_TIMEOUT_MS 1000
+#define RECEIVER_PORT 54321
+
+void debug_sock_v4(const socklen_t* address_size, const struct sockaddr_in* address, char* from) {
+    printf("\nSender size (%s): %u\n", from, *address_size);
+    printf("Sender family (%s): %hu\n", from, address->sin_family);
+    printf("Sender port (%s):: %hu\n", from, ntohs(address->sin_port));
+
+    char *ip_str = calloc(INET_ADDRSTRLEN, sizeof(char));
+    if (ip_str == NULL) {
+        perror("\n\ncalloc");
+        exit(EXIT_FAILURE);
+    }
+
+    inet_ntop(AF_INET, &(address->sin_addr), ip_str, INET_ADDRSTRLEN);
+    printf("Sender address (%s): %s\n", from, ip_str);
+
+    printf("Sender zero (%s): ", from);
+    for (int i = 0; i < sizeof(address->sin_zero); i++) {
+        printf("%hhu ", address->sin_zero[i]);
+    }
+    printf("\n\n");
+
+    // Clean memory
+    free(ip_str);
+}
+
+double elapsed_seconds(const struct timespec* start, const struct timespec* end) {
+    return (double) (end->tv_sec - start->tv_sec) + (double) (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void handle_datagram(const char* datagram, size_t length, size_t* bytes) {
+    // Datagram points into receive buffer, place for user processing
+    if (datagram != NULL) {
+        *bytes += length;
+    }
+}
+
+size_t split_datagrams(const char* buffer, size_t length, size_t segment_size, size_t* bytes) {
+    // Declaration and assign count of logical datagrams
+    size_t count = 0;
+
+    // Walk super-buffer in place, every segment is one datagram of sender, last one can be shorter
+    for (size_t offset = 0; offset < length; offset += segment_size) {
+        size_t datagram_length = (length - offset < segment_size) ? length - offset : segment_size;
+
+        handle_datagram(buffer + offset, datagram_length, bytes);
+
+        ++count;
+    }
+
+    return count;
+}
+
+int process_cmsg(struct cmsghdr* cmsg, int* segment_size) {
+    if (cmsg != NULL) {
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            // Segment size of coalesced datagrams
+            memcpy(segment_size, CMSG_DATA(cmsg), sizeof(int));
+            return 0;
+        }
+        printf("Total current cmsg length: %lu\n", (size_t) cmsg->cmsg_len);
+    }
+
+    return 0;
+}
+
+int main() {
+    // Set buffer for data receive
+    char *iov_buffer = calloc((size_t) BUFF_SIZE, sizeof(char));
+    // Set control buffer for receive data
+    char control_buffer[CMSG_SPACE(sizeof(int))];
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+    // Declaration and assign option value
+    int gro_option = 1;
+    // Declaration and assign sender address struct size
+    socklen_t sender_message_address_size = sizeof(struct sockaddr_storage);
+
+    // Declaration and assign statistics
+    size_t datagrams = 0, bytes = 0, syscalls = 0, coalesced = 0;
+
+    // Declaration and assign time of first and last receive
+    struct timespec first_time = {0}, last_time = {0};
+    // Declaration and assign receive timeout
+    struct timeval timeout = { .tv_sec = IDLE_TIMEOUT_MS / 1000, .tv_usec = (IDLE_TIMEOUT_MS % 1000) * 1000 };
+    // Declaration and assign io vector
+    struct iovec iov = {0};
+    // Declaration and assign message header
+    struct msghdr message = {0};
+    // Declaration and assign socket address unix
+    struct sockaddr_in socket_address = {0};
+    // Declaration and assign client socket address
+    struct sockaddr_storage sender_message_address = {0};
+
+    // Clean buffer
+    memset(&iov, 0, sizeof(iov));
+    memset(&message, 0, sizeof(message));
+    memset(&socket_address, 0, sizeof(socket_address));
+    memset(&sender_message_address, 0, sizeof(sender_message_address));
+
+    if (iov_buffer == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Create socket
+    socket_file_descriptor = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    // Allow kernel to deliver coalesced datagrams
+    if (setsockopt(socket_file_descriptor, SOL_UDP, UDP_GRO, &gro_option, sizeof(gro_option)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
+    // Set socket socket address
+    socket_address.sin_family = PF_INET;
+    socket_address.sin_addr.s_addr = INADDR_ANY;
+    socket_address.sin_port = htons(RECEIVER_PORT);
+
+    // Bind socket to socket address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    // Init iovec
+    iov = (struct iovec) { .iov_base = iov_buffer, .iov_len = (size_t) BUFF_SIZE };
+
+    // Drain socket until it is idle
+    while (1) {
+        // Init msghdr, kernel overwrites lengths
+        message = (struct msghdr) {
+                .msg_name = &sender_message_address, .msg_namelen = sender_message_address_size,
+                .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control_buffer,
+                .msg_controllen = sizeof(control_buffer)
+        };
+
+        // Receive message, can contain many datagrams of one flow
+        ssize_t received = recvmsg(socket_file_descriptor, &message, 0);
+        if (received == -1) {
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && syscalls != 0) {
+                break;
+            }
+            perror("\n\nrecvmsg");
+            return 1;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &last_time);
+
+        // First receive, print info about sender and set idle timeout
+        if (syscalls == 0) {
+            first_time = last_time;
+
+            debug_sock_v4(&message.msg_namelen, (struct sockaddr_in *) &sender_message_address, "recvmsg");
+
+            if (setsockopt(socket_file_descriptor, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == -1) {
+                perror("\n\nsetsockopt");
+                return 1;
+            }
+        }
+
+        ++syscalls;
+
+        // Tail of coalesced buffer did not fit, splitting it would hand out broken datagrams
+        if (message.msg_flags & MSG_TRUNC) {
+            fprintf(stderr, "\n\nrecvmsg: MSG_TRUNC, coalesced buffer is bigger than %d bytes\n", BUFF_SIZE);
+            return 1;
+        }
+
+        // Without UDP_GRO control message buffer holds exactly one datagram
+        int segment_size = (int) received;
+
+        // Handle received ancillary data
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+
+        while (cmsg != NULL) {
+            if (process_cmsg(cmsg, &segment_size) == -1) {
+                fprintf(stderr, "Error message: Something went wrong with process cmsg!\n");
+                exit(1);
+            }
+            cmsg = CMSG_NXTHDR(&message, cmsg);
+        }
+
+        if (segment_size < received) {
+            if (coalesced == 0) {
+                printf("Segment size (UDP_GRO): %i\n", segment_size);
+            }
+            ++coalesced;
+        }
+
+        if (received > 0) {
+            datagrams += split_datagrams(iov_buffer, (size_t) received, (size_t) segment_size, &bytes);
+        } else {
+            // Empty datagram
+            ++datagrams;
+        }
+    }
+
+    double seconds = elapsed_seconds(&first_time, &last_time);
+
+    printf("Received datagrams: %zu\n", datagrams);
+    printf("Received bytes: %zu\n", bytes);
+    printf("Coalesced receives: %zu\n", coalesced);
+    printf("Syscalls: %zu\n", syscalls);
+    printf("Syscalls/datagram: %.4f\n", (double) syscalls / (double) datagrams);
+    printf("Elapsed (first to last receive): %.6f s\n", seconds);
+    if (seconds > 0) {
+        printf("Datagrams/sec: %.0f\n", (double) datagrams / seconds);
+    }
+
+    // Close socket
+    close(socket_file_descriptor);
+
+    // Clean memory
+    free(iov_buffer);
+
+    return 0;
+}
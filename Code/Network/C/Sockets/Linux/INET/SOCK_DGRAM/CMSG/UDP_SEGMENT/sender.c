@@ -0,0 +1,185 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+
+#define CONNECT 0
+// 0 - set UDP_SEGMENT once on socket (setsockopt), 1 - set UDP_SEGMENT on every call (cmsg)
+#define PER_CALL 1
+// Size of one datagram produced by kernel from the large buffer (gso_size)
+#define SEGMENT_SIZE 1000
+// Count of datagrams in one large buffer, kernel accepts up to 64 (UDP_MAX_SEGMENTS)
+#define SEGMENTS 64
+// Count of large buffers to send
+#define CALLS 1024
+#define SENDER_PORT 12345
+#define RECEIVER_PORT 54321
+
+double elapsed_seconds(const struct timespec* start, const struct timespec* end) {
+    return (double) (end->tv_sec - start->tv_sec) + (double) (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main() {
+    // Set large buffer, kernel splits it into SEGMENTS datagrams of SEGMENT_SIZE
+    char *buffer = calloc((size_t) SEGMENTS * SEGMENT_SIZE, sizeof(char));
+    if (buffer == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+    // Declaration and assign segment size
+    uint16_t segment_size = SEGMENT_SIZE;
+
+    // Declaration and assign statistics
+    size_t datagrams = 0, syscalls = 0;
+
+    // Declaration and assign time of start and end of send
+    struct timespec start_time = {0}, end_time = {0};
+    // Declaration and assign input/output vector
+    struct iovec iov = {0};
+    // Declaration and assign message header
+    struct msghdr message = {0};
+    // Declaration and assign socket address unix
+    struct sockaddr_in socket_address = {0};
+    // Declaration and assign target socket address unix
+    struct sockaddr_in target_socket_address = {0};
+
+    // Clean buffer
+    memset(&iov, 0, sizeof(iov));
+    memset(&message, 0, sizeof(message));
+    memset(&socket_address, 0, sizeof(socket_address));
+    memset(&target_socket_address, 0, sizeof(target_socket_address));
+
+    // Create socket
+    socket_file_descriptor = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+#if PER_CALL == 0
+    // Every send on socket is segmented by kernel
+    if (setsockopt(socket_file_descriptor, SOL_UDP, UDP_SEGMENT, &segment_size, sizeof(segment_size)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+#endif
+
+    // Set socket socket address
+    socket_address.sin_family = AF_INET;
+    socket_address.sin_addr.s_addr = INADDR_ANY;
+    socket_address.sin_port = htons(SENDER_PORT);
+
+    // Bind socket to socket address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    // Set target socket address
+    target_socket_address.sin_family = AF_INET;
+    target_socket_address.sin_addr.s_addr = INADDR_ANY;
+    target_socket_address.sin_port = htons(RECEIVER_PORT);
+
+#if CONNECT == 1
+    // Connect to socket
+    if (connect(
+            socket_file_descriptor, (struct sockaddr *) &target_socket_address, sizeof(target_socket_address)
+    ) == -1) {
+        perror("\n\nconnect");
+        return 1;
+    }
+#endif
+
+    // Fill payload of every datagram
+    const char* payload = "Hello, receiver!";
+    for (size_t i = 0; i < (size_t) SEGMENTS * SEGMENT_SIZE; i++) {
+        buffer[i] = payload[i % strlen(payload)];
+    }
+
+    // Init iovec
+    iov = (struct iovec) { .iov_base = buffer, .iov_len = (size_t) SEGMENTS * SEGMENT_SIZE };
+
+    // Init msghdr
+#if CONNECT == 0
+    message = (struct msghdr) {
+            .msg_name = &target_socket_address, .msg_namelen = sizeof(target_socket_address),
+            .msg_iov = &iov, .msg_iovlen = 1
+    };
+#elif CONNECT == 1
+    message = (struct msghdr) { .msg_iov = &iov, .msg_iovlen = 1 };
+#endif
+
+#if PER_CALL == 1
+    // Declaration and assign control buffer with alignment
+    char control_buffer[CMSG_SPACE(sizeof(uint16_t))];
+    memset(control_buffer, 0, sizeof(control_buffer));
+
+    message.msg_control = control_buffer;
+    message.msg_controllen = sizeof(control_buffer);
+
+    // Prepare the control message with segment size
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    *cmsg = (struct cmsghdr) {
+            .cmsg_len = CMSG_LEN(sizeof(uint16_t)), .cmsg_level = SOL_UDP, .cmsg_type = UDP_SEGMENT
+    };
+    memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(uint16_t));
+#endif
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    // Send data
+    for (int i = 0; i < CALLS; i++) {
+        ssize_t bytes_sent = sendmsg(socket_file_descriptor, &message, 0);
+        if (bytes_sent == -1) {
+            perror("\n\nsendmsg");
+            return 1;
+        }
+        datagrams += ((size_t) bytes_sent + SEGMENT_SIZE - 1) / SEGMENT_SIZE; ++syscalls;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    double seconds = elapsed_seconds(&start_time, &end_time);
+
+    printf("Message sent: %s\n", payload);
+    printf("Segment size: %u\n", segment_size);
+    printf("Sent datagrams: %zu\n", datagrams);
+    printf("Sent bytes: %zu\n", datagrams * SEGMENT_SIZE);
+    printf("Syscalls: %zu\n", syscalls);
+    printf("Syscalls/datagram: %.4f\n", (double) syscalls / (double) datagrams);
+    printf("Elapsed: %.6f s\n", seconds);
+    if (seconds > 0) {
+        printf("Datagrams/sec: %.0f\n", (double) datagrams / seconds);
+    }
+
+    // Close socket
+    close(socket_file_descriptor);
+
+    // Clean memory
+    free(buffer);
+
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#define CONNECT 0
+// Count of messages submitted by one sendmmsg call
+#define BURST_SIZE 64
+// Size of one datagram payload
+#define PAYLOAD_SIZE 1024
+// Count of bursts to send
+#define BURSTS 1024
+#define SENDER_PORT 12345
+#define RECEIVER_PORT 54321
+
+double elapsed_seconds(const struct timespec* start, const struct timespec* end) {
+    return (double) (end->tv_sec - start->tv_sec) + (double) (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main() {
+    // Set buffer for payload of all messages in burst
+    char *buffer = calloc((size_t) BURST_SIZE * PAYLOAD_SIZE, sizeof(char));
+    // Set vector of message headers
+    struct mmsghdr *messages = calloc(BURST_SIZE, sizeof(struct mmsghdr));
+    // Set vector of input/output vectors
+    struct iovec *iovs = calloc(BURST_SIZE, sizeof(struct iovec));
+    if (buffer == NULL || messages == NULL || iovs == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+
+    // Declaration and assign statistics
+    size_t packets = 0, syscalls = 0;
+
+    // Declaration and assign time of start and end of send
+    struct timespec start_time = {0}, end_time = {0};
+    // Declaration and assign socket address unix
+    struct sockaddr_in socket_address = {0};
+    // Declaration and assign target socket address unix
+    struct sockaddr_in target_socket_address = {0};
+
+    // Clean buffer
+    memset(&socket_address, 0, sizeof(socket_address));
+    memset(&target_socket_address, 0, sizeof(target_socket_address));
+
+    // Create socket
+    socket_file_descriptor = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    // Set socket socket address
+    socket_address.sin_family = AF_INET;
+    socket_address.sin_addr.s_addr = INADDR_ANY;
+    socket_address.sin_port = htons(SENDER_PORT);
+
+    // Bind socket to socket address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    // Set target socket address
+    target_socket_address.sin_family = AF_INET;
+    target_socket_address.sin_addr.s_addr = INADDR_ANY;
+    target_socket_address.sin_port = htons(RECEIVER_PORT);
+
+#if CONNECT == 1
+    // Connect to socket
+    if (connect(
+            socket_file_descriptor, (struct sockaddr *) &target_socket_address, sizeof(target_socket_address)
+    ) == -1) {
+        perror("\n\nconnect");
+        return 1;
+    }
+#endif
+
+    // Fill payload of every message
+    const char* message = "Hello, receiver!";
+    for (size_t i = 0; i < (size_t) BURST_SIZE * PAYLOAD_SIZE; i++) {
+        buffer[i] = message[i % strlen(message)];
+    }
+
+    // Init burst, every mmsghdr owns one iovec
+    for (int i = 0; i < BURST_SIZE; i++) {
+        iovs[i] = (struct iovec) { .iov_base = buffer + (size_t) i * PAYLOAD_SIZE, .iov_len = (size_t) PAYLOAD_SIZE };
+#if CONNECT == 0
+        messages[i].msg_hdr = (struct msghdr) {
+                .msg_name = &target_socket_address, .msg_namelen = sizeof(target_socket_address),
+                .msg_iov = &iovs[i], .msg_iovlen = 1
+        };
+#elif CONNECT == 1
+        messages[i].msg_hdr = (struct msghdr) { .msg_iov = &iovs[i], .msg_iovlen = 1 };
+#endif
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    // Send data
+    for (int burst = 0; burst < BURSTS; burst++) {
+        // Kernel can send only part of burst, submit the rest again
+        for (int offset = 0; offset < BURST_SIZE;) {
+            int sent = sendmmsg(socket_file_descriptor, messages + offset, BURST_SIZE - offset, 0);
+            if (sent == -1) {
+                perror("\n\nsendmmsg");
+                return 1;
+            }
+            offset += sent; packets += (size_t) sent; ++syscalls;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    double seconds = elapsed_seconds(&start_time, &end_time);
+
+    printf("Message sent: %s\n", message);
+    printf("Sent packets: %zu\n", packets);
+    printf("Sent bytes: %zu\n", packets * PAYLOAD_SIZE);
+    printf("Syscalls: %zu\n", syscalls);
+    printf("Syscalls/packet: %.4f\n", (double) syscalls / (double) packets);
+    printf("Elapsed: %.6f s\n", seconds);
+    if (seconds > 0) {
+        printf("Packets/sec: %.0f\n", (double) packets / seconds);
+    }
+
+    // Close socket
+    close(socket_file_descriptor);
+
+    // Clean memory
+    free(iovs);
+    free(messages);
+    free(buffer);
+
+    return 0;
+}
@@ -0,0 +1,387 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/filter.h>
+
+// Count of sockets and worker threads, 0 - one per CPU allowed to process
+#define SHARDS 0
+#define BUFF_SIZE 65535
+// Stop shard when it is idle for this time after the first datagram of any shard
+#define IDLE_TIMEOUT_MS 1000
+// Compare CPU of socket (SO_INCOMING_CPU) with CPU of worker every N-th datagram
+#define SAMPLE_EVERY 64
+#define RECEIVER_PORT 54321
+
+// Steering of datagrams to sockets of reuseport group, selected by first argument
+enum steering {
+    // Default kernel hashing of 4-tuple
+    STEERING_KERNEL,
+    // cBPF: socket index = shard pinned to CPU that processed datagram
+    STEERING_CPU,
+    // cBPF: socket index = hash of 4-tuple % shards
+    STEERING_HASH
+};
+
+// State of one shard, written by its worker only
+struct shard {
+    pthread_t thread;
+    int socket_file_descriptor;
+    int cpu;
+    size_t packets, bytes, samples, cross_cpu_samples;
+    struct timespec first_time, last_time;
+    // Bitmap of seen source ports, flows of one host differ only by port
+    uint8_t *flows;
+};
+
+// Packets received by all shards, lets idle shards stop after traffic started
+atomic_size_t total_packets = 0;
+
+double elapsed_seconds(const struct timespec* start, const struct timespec* end) {
+    return (double) (end->tv_sec - start->tv_sec) + (double) (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int timespec_before(const struct timespec* left, const struct timespec* right) {
+    return left->tv_sec < right->tv_sec || (left->tv_sec == right->tv_sec && left->tv_nsec < right->tv_nsec);
+}
+
+// Build cBPF program of steering, returns count of instructions
+unsigned short build_steering(enum steering steering, int shards, const int* cpus, int cpu_count,
+                              struct sock_filter* program) {
+    unsigned short length = 0;
+
+    if (steering == STEERING_CPU) {
+        program[length++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_CPU);
+        // Allowed CPU j is processed by shard j % shards, CPU numbers can have gaps
+        for (int j = 0; j < cpu_count; j++) {
+            program[length++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, (uint32_t) cpus[j], 0, 1);
+            program[length++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, (uint32_t) (j % shards));
+        }
+        // Softirq on CPU outside of allowed set
+    } else {
+        // Data starts at UDP payload, headers are read relative to network header
+        // X = IPv4 header length
+        program[length++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_B | BPF_ABS, SKF_NET_OFF);
+        program[length++] = (struct sock_filter) BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x0F);
+        program[length++] = (struct sock_filter) BPF_STMT(BPF_ALU | BPF_LSH | BPF_K, 2);
+        program[length++] = (struct sock_filter) BPF_STMT(BPF_MISC | BPF_TAX, 0);
+        // M[0] = source port << 16 | destination port
+        program[length++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_IND, SKF_NET_OFF);
+        program[length++] = (struct sock_filter) BPF_STMT(BPF_ST, 0);
+        // A = M[0] ^ source address ^ destination address
+        for (int offset = 12; offset <= 16; offset += 4) {
+            program[length++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_NET_OFF + offset);
+            program[length++] = (struct sock_filter) BPF_STMT(BPF_LDX | BPF_W | BPF_MEM, 0);
+            program[length++] = (struct sock_filter) BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0);
+            program[length++] = (struct sock_filter) BPF_STMT(BPF_ST, 0);
+        }
+        // Mix bits, ports alone differ only in low bits
+        program[length++] = (struct sock_filter) BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 0x9E3779B1);
+        program[length++] = (struct sock_filter) BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16);
+    }
+
+    program[length++] = (struct sock_filter) BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t) shards);
+    program[length++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_A, 0);
+
+    return length;
+}
+
+void* receive_shard(void* argument) {
+    // Declaration and assign state of shard
+    struct shard *shard = argument;
+
+    // Set buffer for data receive, one per shard
+    char *buffer = calloc(BUFF_SIZE, sizeof(char));
+    if (buffer == NULL) {
+        perror("\n\ncalloc");
+        exit(EXIT_FAILURE);
+    }
+
+    // Declaration and assign statistics, kept local until worker ends
+    size_t packets = 0, bytes = 0, samples = 0, cross_cpu_samples = 0;
+
+    // Declaration and assign sender message address and its struct size
+    struct sockaddr_in sender_address = {0};
+    socklen_t sender_address_size = sizeof(sender_address);
+
+    while (1) {
+        sender_address_size = sizeof(sender_address);
+        ssize_t received = recvfrom(shard->socket_file_descriptor, buffer, (size_t) BUFF_SIZE, 0,
+                                    (struct sockaddr *) &sender_address, &sender_address_size);
+        if (received == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // Idle, stop only if traffic already started
+                if (atomic_load_explicit(&total_packets, memory_order_relaxed) != 0) {
+                    break;
+                }
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("\n\nrecvfrom");
+            exit(EXIT_FAILURE);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &shard->last_time);
+        if (packets == 0) {
+            shard->first_time = shard->last_time;
+        }
+
+        uint16_t port = ntohs(sender_address.sin_port);
+        shard->flows[port >> 3] |= (uint8_t) (1 << (port & 7));
+
+        if (packets % SAMPLE_EVERY == 0) {
+            // Declaration and assign CPU which processed last datagram of socket
+            int incoming_cpu = -1;
+            socklen_t incoming_cpu_size = sizeof(incoming_cpu);
+
+            // Kernel can leave it unset (-1) for unconnected sockets, such samples are skipped
+            if (getsockopt(
+                    shard->socket_file_descriptor, SOL_SOCKET, SO_INCOMING_CPU, &incoming_cpu, &incoming_cpu_size
+            ) == 0 && incoming_cpu >= 0) {
+                ++samples;
+                if (incoming_cpu != sched_getcpu()) {
+                    ++cross_cpu_samples;
+                }
+            }
+        }
+
+        ++packets; bytes += (size_t) received;
+        atomic_fetch_add_explicit(&total_packets, 1, memory_order_relaxed);
+    }
+
+    shard->packets = packets; shard->bytes = bytes;
+    shard->samples = samples; shard->cross_cpu_samples = cross_cpu_samples;
+
+    // Clean memory
+    free(buffer);
+
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    // Declaration and assign steering, usage: receiver [kernel|cpu|hash]
+    enum steering steering = STEERING_KERNEL;
+    if (argc > 1 && strcmp(argv[1], "cpu") == 0) {
+        steering = STEERING_CPU;
+    } else if (argc > 1 && strcmp(argv[1], "hash") == 0) {
+        steering = STEERING_HASH;
+    } else if (argc > 1 && strcmp(argv[1], "kernel") != 0) {
+        fprintf(stderr, "Usage: %s [kernel|cpu|hash]\n", argv[0]);
+        return 1;
+    }
+
+    // Declaration and assign CPUs allowed to process, cpuset or taskset can leave out online CPUs
+    cpu_set_t allowed_set;
+    CPU_ZERO(&allowed_set);
+    if (sched_getaffinity(0, sizeof(allowed_set), &allowed_set) == -1) {
+        perror("\n\nsched_getaffinity");
+        return 1;
+    }
+
+    // Set list of allowed CPUs, shard i is pinned to i-th of them
+    int cpus = CPU_COUNT(&allowed_set);
+    int *allowed_cpus = calloc((size_t) cpus, sizeof(int));
+    if (allowed_cpus == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+    for (int cpu = 0, j = 0; cpu < CPU_SETSIZE && j < cpus; cpu++) {
+        if (CPU_ISSET(cpu, &allowed_set)) {
+            allowed_cpus[j++] = cpu;
+        }
+    }
+
+    // Declaration and assign count of shards
+    int shards = SHARDS != 0 ? SHARDS : cpus;
+
+    // Set state of all shards
+    struct shard *shard_states = calloc((size_t) shards, sizeof(struct shard));
+    if (shard_states == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+    for (int i = 0; i < shards; i++) {
+        shard_states[i].flows = calloc(65536 / 8, sizeof(uint8_t));
+        if (shard_states[i].flows == NULL) {
+            perror("\n\ncalloc");
+            return 1;
+        }
+    }
+
+    // Declaration and assign socket option value
+    int enable = 1;
+
+    // Declaration and assign cBPF program of steering
+    struct sock_filter program[2 * CPU_SETSIZE + 32] = {0};
+    struct sock_fprog filter = { .len = build_steering(steering, shards, allowed_cpus, cpus, program), .filter = program };
+    // Declaration and assign receive timeout
+    struct timeval timeout = { .tv_sec = IDLE_TIMEOUT_MS / 1000, .tv_usec = (IDLE_TIMEOUT_MS % 1000) * 1000 };
+    // Declaration and assign socket address unix
+    struct sockaddr_in socket_address = {0};
+
+    // Clean buffer
+    memset(&socket_address, 0, sizeof(socket_address));
+
+    // Set socket socket address
+    socket_address.sin_family = PF_INET;
+    socket_address.sin_addr.s_addr = INADDR_ANY;
+    socket_address.sin_port = htons(RECEIVER_PORT);
+
+    // Bind all sockets before any worker starts, kernel spreads flows only over sockets of the group
+    for (int i = 0; i < shards; i++) {
+        // Create socket
+        shard_states[i].socket_file_descriptor = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (shard_states[i].socket_file_descriptor == -1) {
+            perror("\n\nsocket");
+            return 1;
+        }
+
+        // Join reuseport group, flows are hashed by 4-tuple to one socket of group
+        if (setsockopt(
+                shard_states[i].socket_file_descriptor, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)
+        ) == -1) {
+            perror("\n\nsetsockopt");
+            return 1;
+        }
+
+        // Set idle timeout
+        if (setsockopt(
+                shard_states[i].socket_file_descriptor, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)
+        ) == -1) {
+            perror("\n\nsetsockopt");
+            return 1;
+        }
+
+        // Bind socket to socket address, index of socket in group is order of bind
+        if (bind(
+                shard_states[i].socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)
+        ) == -1) {
+            perror("\n\nbind");
+            return 1;
+        }
+    }
+
+    // Attach steering to group, program returns index of socket
+    if (steering != STEERING_KERNEL && setsockopt(
+            shard_states[0].socket_file_descriptor, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &filter, sizeof(filter)
+    ) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
+    printf("Shards: %d, CPUs: %d, steering: %s\n", shards, cpus,
+           steering == STEERING_CPU ? "cpu" : steering == STEERING_HASH ? "hash" : "kernel");
+
+    // Start one worker per shard, pinned to its CPU
+    for (int i = 0; i < shards; i++) {
+        // Declaration and assign thread attributes and CPU set
+        pthread_attr_t attributes;
+        cpu_set_t cpu_set;
+
+        shard_states[i].cpu = allowed_cpus[i % cpus];
+
+        CPU_ZERO(&cpu_set);
+        CPU_SET(shard_states[i].cpu, &cpu_set);
+
+        pthread_attr_init(&attributes);
+        if (pthread_attr_setaffinity_np(&attributes, sizeof(cpu_set), &cpu_set) != 0) {
+            fprintf(stderr, "\n\npthread_attr_setaffinity_np: failed\n");
+            return 1;
+        }
+
+        if (pthread_create(&shard_states[i].thread, &attributes, receive_shard, &shard_states[i]) != 0) {
+            fprintf(stderr, "\n\npthread_create: failed\n");
+            return 1;
+        }
+
+        pthread_attr_destroy(&attributes);
+    }
+
+    // Declaration and assign totals
+    size_t packets = 0, bytes = 0, samples = 0, cross_cpu_samples = 0, flows = 0, split_flows = 0;
+    // Declaration and assign time of first and last datagram of all shards
+    struct timespec first_time = {0}, last_time = {0};
+
+    for (int i = 0; i < shards; i++) {
+        pthread_join(shard_states[i].thread, NULL);
+    }
+
+    for (int i = 0; i < shards; i++) {
+        printf("Shard %d (CPU %d): packets %zu, bytes %zu\n",
+               i, shard_states[i].cpu, shard_states[i].packets, shard_states[i].bytes);
+
+        samples += shard_states[i].samples; cross_cpu_samples += shard_states[i].cross_cpu_samples;
+
+        if (shard_states[i].packets == 0) {
+            continue;
+        }
+
+        if (packets == 0 || timespec_before(&shard_states[i].first_time, &first_time)) {
+            first_time = shard_states[i].first_time;
+        }
+        if (packets == 0 || timespec_before(&last_time, &shard_states[i].last_time)) {
+            last_time = shard_states[i].last_time;
+        }
+
+        packets += shard_states[i].packets; bytes += shard_states[i].bytes;
+    }
+
+    // Count flows and flows received by more than one shard
+    for (int port = 0; port < 65536; port++) {
+        int owners = 0;
+        for (int i = 0; i < shards; i++) {
+            owners += (shard_states[i].flows[port >> 3] >> (port & 7)) & 1;
+        }
+        flows += owners != 0; split_flows += owners > 1;
+    }
+
+    double seconds = elapsed_seconds(&first_time, &last_time);
+
+    printf("Received packets: %zu\n", packets);
+    printf("Received bytes: %zu\n", bytes);
+    printf("Flows: %zu, split over shards: %zu\n", flows, split_flows);
+    printf("Cross-CPU samples: %zu/%zu\n", cross_cpu_samples, samples);
+    printf("Elapsed (first to last datagram): %.6f s\n", seconds);
+    if (seconds > 0) {
+        printf("Packets/sec: %.0f\n", (double) packets / seconds);
+    }
+
+    // Close sockets
+    for (int i = 0; i < shards; i++) {
+        close(shard_states[i].socket_file_descriptor);
+    }
+
+    // Clean memory
+    for (int i = 0; i < shards; i++) {
+        free(shard_states[i].flows);
+    }
+    free(shard_states);
+    free(allowed_cpus);
+
+    return 0;
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+// Count of sockets, every socket is one flow with its own ephemeral source port
+#define SOURCES 64
+// Count of datagrams sent from every source
+#define PACKETS_PER_SOURCE 4096
+// Size of one datagram payload
+#define PAYLOAD_SIZE 1024
+#define RECEIVER_PORT 54321
+
+double elapsed_seconds(const struct timespec* start, const struct timespec* end) {
+    return (double) (end->tv_sec - start->tv_sec) + (double) (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main() {
+    // Set buffer for payload
+    char *buffer = calloc(PAYLOAD_SIZE, sizeof(char));
+    // Set descriptors of all sources
+    int *socket_file_descriptors = calloc(SOURCES, sizeof(int));
+    if (buffer == NULL || socket_file_descriptors == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign statistics
+    size_t packets = 0;
+
+    // Declaration and assign time of start and end of send
+    struct timespec start_time = {0}, end_time = {0};
+    // Declaration and assign socket address unix
+    struct sockaddr_in socket_address = {0};
+    // Declaration and assign target socket address unix
+    struct sockaddr_in target_socket_address = {0};
+
+    // Clean buffer
+    memset(&socket_address, 0, sizeof(socket_address));
+    memset(&target_socket_address, 0, sizeof(target_socket_address));
+
+    // Set socket socket address, port 0 - kernel assigns ephemeral port
+    socket_address.sin_family = AF_INET;
+    socket_address.sin_addr.s_addr = INADDR_ANY;
+    socket_address.sin_port = htons(0);
+
+    // Set target socket address
+    target_socket_address.sin_family = AF_INET;
+    target_socket_address.sin_addr.s_addr = INADDR_ANY;
+    target_socket_address.sin_port = htons(RECEIVER_PORT);
+
+    for (int i = 0; i < SOURCES; i++) {
+        // Create socket
+        socket_file_descriptors[i] = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (socket_file_descriptors[i] == -1) {
+            perror("\n\nsocket");
+            return 1;
+        }
+
+        // Bind socket to socket address
+        if (bind(socket_file_descriptors[i], (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+            perror("\n\nbind");
+            return 1;
+        }
+    }
+
+    // Fill payload
+    const char* message = "Hello, receiver!";
+    for (size_t i = 0; i < PAYLOAD_SIZE; i++) {
+        buffer[i] = message[i % strlen(message)];
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    // Send data, every round touches every source
+    for (int round = 0; round < PACKETS_PER_SOURCE; round++) {
+        for (int i = 0; i < SOURCES; i++) {
+            ssize_t bytes_sent = sendto(socket_file_descriptors[i], buffer, PAYLOAD_SIZE, 0,
+                                        (struct sockaddr *) &target_socket_address, sizeof(target_socket_address));
+            if (bytes_sent == -1) {
+                perror("\n\nsendto");
+                return 1;
+            }
+            ++packets;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    double seconds = elapsed_seconds(&start_time, &end_time);
+
+    printf("Message sent: %s\n", message);
+    printf("Sources: %d\n", SOURCES);
+    printf("Sent packets: %zu\n", packets);
+    printf("Sent bytes: %zu\n", packets * PAYLOAD_SIZE);
+    printf("Elapsed: %.6f s\n", seconds);
+    if (seconds > 0) {
+        printf("Packets/sec: %.0f\n", (double) packets / seconds);
+    }
+
+    // Close sockets
+    for (int i = 0; i < SOURCES; i++) {
+        close(socket_file_descriptors[i]);
+    }
+
+    // Clean memory
+    free(socket_file_descriptors);
+    free(buffer);
+
+    return 0;
+}
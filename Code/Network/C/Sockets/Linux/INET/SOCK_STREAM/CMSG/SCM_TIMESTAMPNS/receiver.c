@@ -24,7 +24,9 @@
 #include <linux/errqueue.h>
 #include <linux/net_tstamp.h>
 
-#define TIME_SIZE 20
+#include "monitor.h"
+#include "time_format.h"
+
 #define BUFF_SIZE 65535
 #define RECEIVER_PORT 54321
 
@@ -52,28 +54,17 @@ void debug_sock_v4(const socklen_t* address_size, const struct sockaddr_in* addr
     free(ip_str);
 }
 
-int decode_timespec(struct timespec* timestamp) {
-    // Convert time_t to the broken-down time (struct tm)
-    struct tm *time_info = localtime(&timestamp->tv_sec);
-
-    // Print the time in the desired format
-    char *time_str = calloc((size_t) TIME_SIZE, sizeof(char));
-    if (time_str == NULL) {
-        perror("\n\ncalloc");
-        return -1;
-    }
+// Local time of last second, shared by every decode of receiver
+struct time_format time_format = {0};
 
-    strftime(time_str, (size_t) TIME_SIZE, "%Y-%m-%d %H:%M:%S", time_info);
-    printf("Timestamp (strftime - timespec): %s\n", time_str);
+int decode_timespec(struct timespec* timestamp) {
+    // Declaration and assign buffer of time, formatter renders date only when second changes
+    char time_str[TIME_FORMAT_SIZE] = {0};
 
-    // Print the time in the manual format
-    printf("Timestamp (manually - timespec): %02d-%02d-%04d %02d:%02d:%02d.%06ld\n\n",
-           time_info->tm_mday, time_info->tm_mon + 1, time_info->tm_year + 1900,
-           time_info->tm_hour, time_info->tm_min, time_info->tm_sec, timestamp->tv_nsec);
+    time_format_timespec(&time_format, timestamp, time_str, sizeof(time_str));
+    printf("Timestamp (time_format - timespec): %s\n\n", time_str);
 
     // Clean memory
-    free(time_info);
-    free(time_str);
     free(timestamp);
 
     return 0;
@@ -99,7 +90,28 @@ int process_cmsg(struct cmsghdr* cmsg) {
     return 0;
 }
 
-int main() {
+// Stamp of SO_TIMESTAMPNS is CLOCK_REALTIME
+int stamp_scm_timestampns(const struct cmsghdr* cmsg, struct timespec* timestamp) {
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPNS) {
+        return -1;
+    }
+
+    memcpy(timestamp, CMSG_DATA(cmsg), sizeof(struct timespec));
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Monitor receives until end and keeps latency of every message, otherwise one message is printed
+    int monitor = argc == 2 && strcmp(argv[1], "monitor") == 0;
+    if (argc > 2 || (argc == 2 && !monitor)) {
+        fprintf(stderr, "Usage: %s [monitor]\n", argv[0]);
+        return 1;
+    }
+
+    // Zone is read once, not on every stamp
+    time_format_init(&time_format);
+
     // Set buffer for data receive
     char *iov_buffer = calloc((size_t) BUFF_SIZE, sizeof(char));
     // Set control buffer for receive data
@@ -184,29 +196,38 @@ int main() {
             .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control_buffer, .msg_controllen = (size_t) BUFF_SIZE
     };
 
-    // Receive message with file descriptor
-    ssize_t received = recvmsg(client_file_descriptor, &message, 0);
-    if (received == -1) {
-        perror("\n\nrecvmsg");
-        return 1;
-    }
+    // Declaration and assign ancillary data header
+    struct cmsghdr *cmsg = NULL;
+
+    if (monitor) {
+        if (monitor_latencies(client_file_descriptor, &message, stamp_scm_timestampns) == -1) {
+            return 1;
+        }
+    } else {
+        // Receive message with file descriptor
+        ssize_t received = recvmsg(client_file_descriptor, &message, 0);
+        if (received == -1) {
+            perror("\n\nrecvmsg");
+            return 1;
+        }
 
-    // Get sender address info from message
-    debug_sock_v4(&sender_message_address_size, (struct sockaddr_in *) &sender_message_address, "recvmsg");
+        // Get sender address info from message
+        debug_sock_v4(&sender_message_address_size, (struct sockaddr_in *) &sender_message_address, "recvmsg");
 
-    printf("iov_base: %s\n", iov_buffer);
-    printf("iov_base_len: %lu\n", iov.iov_len);
-    printf("Current iov length: %i\n\n", message.msg_iovlen);
+        printf("iov_base: %s\n", iov_buffer);
+        printf("iov_base_len: %lu\n", iov.iov_len);
+        printf("Current iov length: %i\n\n", message.msg_iovlen);
 
-    // Handle received ancillary data
-    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+        // Handle received ancillary data
+        cmsg = CMSG_FIRSTHDR(&message);
 
-    while (cmsg != NULL) {
-        if (process_cmsg(cmsg) == -1) {
-            fprintf(stderr, "Error message: Something went wrong with process cmsg!\n");
-            exit(1);
+        while (cmsg != NULL) {
+            if (process_cmsg(cmsg) == -1) {
+                fprintf(stderr, "Error message: Something went wrong with process cmsg!\n");
+                exit(1);
+            }
+            cmsg = CMSG_NXTHDR(&message, cmsg);
         }
-        cmsg = CMSG_NXTHDR(&message, cmsg);
     }
 
     // Close socket
@@ -0,0 +1,514 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// Count of clients served at the same time
+#define MAX_CLIENTS 1024
+// Pass live client sockets to new instance too, 0 - only listening socket
+#define HANDOFF_CLIENTS 1
+// Count of descriptors in one SCM_RIGHTS message, kernel limit is SCM_MAX_FD (253)
+#define HANDOFF_BATCH 64
+#define BUFF_SIZE 65535
+// Time given to slow clients to take queued echo before handoff, client is closed after it
+#define HANDOFF_FLUSH_MS 1000
+#define RECEIVER_PORT 54321
+// Control channel, new instance connects to it to take over
+#define CONTROL_SOCKET_PATH "/tmp/RECEIVER_HANDOFF"
+
+// Messages of control channel, old instance sends them in this order
+enum handoff_type {
+    HANDOFF_LISTENER = 1,
+    HANDOFF_CLIENT_BATCH = 2,
+    HANDOFF_DONE = 3
+};
+
+struct handoff_message {
+    uint32_t type;
+    uint32_t count;
+};
+
+// Echo not yet taken by slow client, client is not read until it is sent
+struct pending_echo {
+    char *data;
+    size_t length;
+    size_t offset;
+};
+
+// Set by signal handler to stop instance
+volatile sig_atomic_t running = 1;
+
+void stop(int signal_number) {
+    (void) signal_number;
+    running = 0;
+}
+
+uint64_t now_ns() {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+// Returns 1 when queued echo is sent, 0 when client is not ready, -1 on error
+int flush_echo(int client_file_descriptor, struct pending_echo* echo) {
+    while (echo->offset < echo->length) {
+        ssize_t sent = send(client_file_descriptor, echo->data + echo->offset, echo->length - echo->offset,
+                            MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                return 0;
+            }
+            return -1;
+        }
+        echo->offset += (size_t) sent;
+    }
+
+    free(echo->data);
+    *echo = (struct pending_echo) {0};
+
+    return 1;
+}
+
+int send_handoff(int channel_file_descriptor, uint32_t type, const int* descriptors, uint32_t count) {
+    // Declaration and assign handoff message
+    struct handoff_message handoff = { .type = type, .count = count };
+    // Declaration and assign input/output vector
+    struct iovec iov = { .iov_base = &handoff, .iov_len = sizeof(handoff) };
+    // Declaration and assign message header
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    // Set control buffer, aligned for cmsghdr
+    union {
+        char buffer[CMSG_SPACE(sizeof(int) * HANDOFF_BATCH)];
+        struct cmsghdr align;
+    } control = {0};
+
+    if (count != 0) {
+        message.msg_control = control.buffer;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+        memcpy(CMSG_DATA(cmsg), descriptors, sizeof(int) * count);
+    }
+
+    if (sendmsg(channel_file_descriptor, &message, MSG_NOSIGNAL) == -1) {
+        perror("\n\nsendmsg");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Returns count of received descriptors, -1 on error
+int receive_handoff(int channel_file_descriptor, struct handoff_message* handoff, int* descriptors) {
+    // Declaration and assign input/output vector
+    struct iovec iov = { .iov_base = handoff, .iov_len = sizeof(*handoff) };
+    // Declaration and assign message header
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    // Set control buffer, aligned for cmsghdr
+    union {
+        char buffer[CMSG_SPACE(sizeof(int) * HANDOFF_BATCH)];
+        struct cmsghdr align;
+    } control = {0};
+
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    ssize_t received = recvmsg(channel_file_descriptor, &message, MSG_CMSG_CLOEXEC);
+    if (received != sizeof(*handoff)) {
+        if (received == -1) {
+            perror("\n\nrecvmsg");
+        } else {
+            fprintf(stderr, "\n\nrecvmsg: control channel closed\n");
+        }
+        return -1;
+    }
+    if (message.msg_flags & MSG_CTRUNC) {
+        fprintf(stderr, "\n\nrecvmsg: descriptors truncated\n");
+        return -1;
+    }
+
+    int count = 0;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            count = (int) ((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+            memcpy(descriptors, CMSG_DATA(cmsg), sizeof(int) * (size_t) count);
+        }
+    }
+
+    return count;
+}
+
+int create_listener() {
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+    // Declaration and assign socket option value
+    int enable = 1;
+
+    // Declaration and assign socket address unix
+    struct sockaddr_in socket_address = {0};
+
+    // Clean buffer
+    memset(&socket_address, 0, sizeof(socket_address));
+
+    // Create non-blocking socket
+    socket_file_descriptor = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return -1;
+    }
+
+    // Allow restart while old connections are in TIME_WAIT
+    if (setsockopt(socket_file_descriptor, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == -1) {
+        perror("\n\nsetsockopt");
+        return -1;
+    }
+
+    // Set socket socket address
+    socket_address.sin_family = PF_INET;
+    socket_address.sin_addr.s_addr = INADDR_ANY;
+    socket_address.sin_port = htons(RECEIVER_PORT);
+
+    // Bind socket to address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return -1;
+    }
+
+    // Listen for incoming connections
+    if (listen(socket_file_descriptor, SOMAXCONN) == -1) {
+        perror("\n\nlisten");
+        return -1;
+    }
+
+    return socket_file_descriptor;
+}
+
+int main() {
+    // Set buffer for data receive
+    char *buffer = calloc((size_t) BUFF_SIZE, sizeof(char));
+    // Set poll vector, listening socket, control socket, clients
+    struct pollfd *poll_descriptors = calloc(MAX_CLIENTS + 2, sizeof(struct pollfd));
+    // Set queued echo of clients, same index as poll vector
+    struct pending_echo *pending = calloc(MAX_CLIENTS + 2, sizeof(struct pending_echo));
+    // Set buffer for descriptors of one handoff message
+    int *descriptors = calloc(HANDOFF_BATCH, sizeof(int));
+    if (buffer == NULL || poll_descriptors == NULL || pending == NULL || descriptors == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign listening socket descriptor
+    int socket_file_descriptor = -1;
+    // Declaration and assign control socket descriptor
+    int control_file_descriptor = -1;
+    // Declaration and assign count of watched descriptors
+    nfds_t count = 2;
+    // Declaration and assign flag of finished handoff
+    int handed_off = 0;
+
+    // Declaration and assign statistics
+    uint64_t accepted = 0, taken_clients = 0, passed_clients = 0, dropped_clients = 0, bytes = 0;
+
+    // Declaration and assign control socket address unix
+    struct sockaddr_un control_address = {0};
+    // Declaration and assign signal action
+    struct sigaction action = {0};
+
+    // Clean buffer
+    memset(&control_address, 0, sizeof(control_address));
+    memset(&action, 0, sizeof(action));
+
+    // Set control socket address
+    control_address.sun_family = PF_UNIX;
+    strcpy(control_address.sun_path, CONTROL_SOCKET_PATH);
+
+    // Create control socket
+    control_file_descriptor = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (control_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    // Take over running instance, if there is one
+    if (connect(control_file_descriptor, (struct sockaddr *) &control_address, sizeof(control_address)) == 0) {
+        uint64_t start_ns = now_ns();
+
+        while (1) {
+            struct handoff_message handoff = {0};
+
+            int received = receive_handoff(control_file_descriptor, &handoff, descriptors);
+            if (received == -1) {
+                return 1;
+            }
+
+            if (handoff.type == HANDOFF_LISTENER && received == 1) {
+                socket_file_descriptor = descriptors[0];
+            } else if (handoff.type == HANDOFF_CLIENT_BATCH) {
+                for (int i = 0; i < received; i++) {
+                    if (count == MAX_CLIENTS + 2) {
+                        close(descriptors[i]);
+                        continue;
+                    }
+                    poll_descriptors[count++] = (struct pollfd) { .fd = descriptors[i], .events = POLLIN };
+                    ++taken_clients;
+                }
+            } else if (handoff.type == HANDOFF_DONE) {
+                break;
+            }
+        }
+
+        if (socket_file_descriptor == -1) {
+            fprintf(stderr, "\n\nhandoff: no listening socket\n");
+            return 1;
+        }
+
+        printf("Took over listener and %lu clients in %.3f ms\n",
+               (unsigned long) taken_clients, (double) (now_ns() - start_ns) / 1e6);
+
+        close(control_file_descriptor);
+    } else {
+        if (errno != ENOENT && errno != ECONNREFUSED) {
+            perror("\n\nconnect");
+            return 1;
+        }
+
+        close(control_file_descriptor);
+
+        socket_file_descriptor = create_listener();
+        if (socket_file_descriptor == -1) {
+            return 1;
+        }
+
+        printf("Listening on port: %d\n", RECEIVER_PORT);
+    }
+
+    // Serve control channel, old instance does not remove it after handoff
+    unlink(CONTROL_SOCKET_PATH);
+
+    control_file_descriptor = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (control_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+    if (bind(control_file_descriptor, (struct sockaddr *) &control_address, sizeof(control_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+    if (listen(control_file_descriptor, 1) == -1) {
+        perror("\n\nlisten");
+        return 1;
+    }
+
+    poll_descriptors[0] = (struct pollfd) { .fd = socket_file_descriptor, .events = POLLIN };
+    poll_descriptors[1] = (struct pollfd) { .fd = control_file_descriptor, .events = POLLIN };
+
+    // Stop instance on SIGINT and SIGTERM
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    printf("Instance pid: %d, control: %s\n", getpid(), CONTROL_SOCKET_PATH);
+    fflush(stdout);
+
+    while (running && !handed_off) {
+        // Table is full, stop watching listener until client closes, pending connections wait in queue
+        poll_descriptors[0].events = count < MAX_CLIENTS + 2 ? POLLIN : 0;
+
+        if (poll(poll_descriptors, count, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("\n\npoll");
+            return 1;
+        }
+
+        // Echo data of ready clients, closed client is replaced by last entry
+        for (nfds_t i = 2; i < count;) {
+            if (poll_descriptors[i].revents == 0) {
+                i++;
+                continue;
+            }
+
+            // Slow client became writable, send queued echo and read it again
+            if (pending[i].data != NULL) {
+                int flushed = flush_echo(poll_descriptors[i].fd, &pending[i]);
+                if (flushed == 1) {
+                    poll_descriptors[i].events = POLLIN;
+                }
+                if (flushed != -1) {
+                    i++;
+                    continue;
+                }
+            } else {
+                ssize_t received = recv(poll_descriptors[i].fd, buffer, (size_t) BUFF_SIZE, MSG_DONTWAIT);
+                if (received > 0) {
+                    ssize_t sent = send(poll_descriptors[i].fd, buffer, (size_t) received, MSG_NOSIGNAL | MSG_DONTWAIT);
+                    if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                        sent = 0;
+                    }
+                    if (sent != -1) {
+                        bytes += (uint64_t) received;
+
+                        // Client does not take echo, queue the rest and wait until it is writable
+                        if (sent < received) {
+                            pending[i].length = (size_t) (received - sent);
+                            pending[i].data = malloc(pending[i].length);
+                            if (pending[i].data == NULL) {
+                                perror("\n\nmalloc");
+                                return 1;
+                            }
+                            memcpy(pending[i].data, buffer + sent, pending[i].length);
+                            poll_descriptors[i].events = POLLOUT;
+                        }
+                        i++;
+                        continue;
+                    }
+                }
+                if (received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                    i++;
+                    continue;
+                }
+            }
+
+            close(poll_descriptors[i].fd);
+            free(pending[i].data);
+            poll_descriptors[i] = poll_descriptors[--count];
+            pending[i] = pending[count];
+            pending[count] = (struct pending_echo) {0};
+        }
+
+        // Accept every pending connection, listen queue is kept by handoff
+        while (poll_descriptors[0].revents != 0 && count < MAX_CLIENTS + 2) {
+            int client_file_descriptor = accept4(socket_file_descriptor, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (client_file_descriptor == -1) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED && errno != EINTR) {
+                    perror("\n\naccept4");
+                }
+                break;
+            }
+
+            poll_descriptors[count++] = (struct pollfd) { .fd = client_file_descriptor, .events = POLLIN };
+            ++accepted;
+        }
+
+        if (poll_descriptors[1].revents == 0) {
+            continue;
+        }
+
+        // New instance takes over, stop accepting and pass sockets
+        int channel_file_descriptor = accept4(control_file_descriptor, NULL, NULL, SOCK_CLOEXEC);
+        if (channel_file_descriptor == -1) {
+            perror("\n\naccept4");
+            continue;
+        }
+
+        if (send_handoff(channel_file_descriptor, HANDOFF_LISTENER, &socket_file_descriptor, 1) == -1) {
+            close(channel_file_descriptor);
+            continue;
+        }
+
+#if HANDOFF_CLIENTS == 1
+        // Queued echo is not passed, send it before handoff or close slow client
+        uint64_t deadline_ns = now_ns() + (uint64_t) HANDOFF_FLUSH_MS * 1000000ULL;
+        for (nfds_t i = 2; i < count;) {
+            while (pending[i].data != NULL && flush_echo(poll_descriptors[i].fd, &pending[i]) == 0) {
+                uint64_t current_ns = now_ns();
+                if (current_ns >= deadline_ns) {
+                    break;
+                }
+
+                struct pollfd writable = { .fd = poll_descriptors[i].fd, .events = POLLOUT };
+                poll(&writable, 1, (int) ((deadline_ns - current_ns + 999999ULL) / 1000000ULL));
+            }
+
+            if (pending[i].data == NULL) {
+                i++;
+                continue;
+            }
+
+            close(poll_descriptors[i].fd);
+            free(pending[i].data);
+            poll_descriptors[i] = poll_descriptors[--count];
+            pending[i] = pending[count];
+            pending[count] = (struct pending_echo) {0};
+            ++dropped_clients;
+        }
+
+        for (nfds_t i = 2; i < count; i += HANDOFF_BATCH) {
+            uint32_t batch = (uint32_t) (count - i < HANDOFF_BATCH ? count - i : HANDOFF_BATCH);
+
+            for (uint32_t j = 0; j < batch; j++) {
+                descriptors[j] = poll_descriptors[i + j].fd;
+            }
+            if (send_handoff(channel_file_descriptor, HANDOFF_CLIENT_BATCH, descriptors, batch) == -1) {
+                return 1;
+            }
+            passed_clients += batch;
+        }
+#endif
+
+        if (send_handoff(channel_file_descriptor, HANDOFF_DONE, NULL, 0) == -1) {
+            return 1;
+        }
+
+        close(channel_file_descriptor);
+        handed_off = 1;
+    }
+
+    printf("Instance pid %d %s\n", getpid(), handed_off ? "handed off" : "stopped");
+    printf("Accepted connections: %lu\n", (unsigned long) accepted);
+    printf("Clients taken over: %lu, passed on: %lu\n", (unsigned long) taken_clients, (unsigned long) passed_clients);
+    printf("Clients closed with queued echo: %lu\n", (unsigned long) dropped_clients);
+    printf("Echoed bytes: %lu\n", (unsigned long) bytes);
+
+    // Close sockets, passed sockets stay open in new instance
+    for (nfds_t i = 2; i < count; i++) {
+        close(poll_descriptors[i].fd);
+        free(pending[i].data);
+    }
+    close(control_file_descriptor);
+    close(socket_file_descriptor);
+
+    // Remove control socket, new instance owns it after handoff
+    if (!handed_off) {
+        unlink(CONTROL_SOCKET_PATH);
+    }
+
+    // Clean memory
+    free(descriptors);
+    free(pending);
+    free(poll_descriptors);
+    free(buffer);
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// Run load for this time, start new receiver instance meanwhile to measure handoff
+#define DURATION_MS 5000
+// Count of connections kept open for the whole run, they must survive handoff
+#define PERSISTENT_CLIENTS 16
+// Limit of recorded latencies
+#define MAX_ATTEMPTS (1 << 20)
+// Attempt fails if echo does not come back in this time
+#define TIMEOUT_MS 1000
+#define RECEIVER_PORT 54321
+
+uint64_t now_ns() {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+int compare_latency(const void* left, const void* right) {
+    uint64_t a = *(const uint64_t *) left, b = *(const uint64_t *) right;
+    return (a > b) - (a < b);
+}
+
+// Send message and wait its echo, returns 0 on success
+int ping(int file_descriptor) {
+    const char* message = "ping";
+    char echo[4] = {0};
+
+    if (send(file_descriptor, message, sizeof(echo), MSG_NOSIGNAL) != sizeof(echo)) {
+        return -1;
+    }
+    if (recv(file_descriptor, echo, sizeof(echo), MSG_WAITALL) != sizeof(echo)) {
+        return -1;
+    }
+
+    return memcmp(echo, message, sizeof(echo)) == 0 ? 0 : -1;
+}
+
+int open_client(const struct sockaddr_in* target_socket_address) {
+    // Declaration and assign timeouts
+    struct timeval timeout = { .tv_sec = TIMEOUT_MS / 1000, .tv_usec = (TIMEOUT_MS % 1000) * 1000 };
+    // Close with RST, otherwise TIME_WAIT of client side exhausts ephemeral ports
+    struct linger linger = { .l_onoff = 1, .l_linger = 0 };
+
+    int file_descriptor = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (file_descriptor == -1) {
+        perror("\n\nsocket");
+        exit(EXIT_FAILURE);
+    }
+
+    setsockopt(file_descriptor, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(file_descriptor, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(file_descriptor, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+
+    if (connect(
+            file_descriptor, (const struct sockaddr *) target_socket_address, sizeof(*target_socket_address)
+    ) == -1) {
+        close(file_descriptor);
+        return -1;
+    }
+
+    return file_descriptor;
+}
+
+int main() {
+    // Set latencies of successful attempts
+    uint64_t *latencies = calloc(MAX_ATTEMPTS, sizeof(uint64_t));
+    // Set descriptors of persistent clients
+    int *persistent_file_descriptors = calloc(PERSISTENT_CLIENTS, sizeof(int));
+    if (latencies == NULL || persistent_file_descriptors == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign statistics
+    size_t attempts = 0, succeeded = 0, connect_failures = 0, echo_failures = 0;
+    size_t pings = 0, ping_failures = 0, survived = 0;
+    uint64_t total_ns = 0, slowest_ns = 0, slowest_at_ns = 0;
+
+    // Declaration and assign target socket address unix
+    struct sockaddr_in target_socket_address = {0};
+
+    // Clean buffer
+    memset(&target_socket_address, 0, sizeof(target_socket_address));
+
+    // Set target socket address
+    target_socket_address.sin_family = PF_INET;
+    target_socket_address.sin_addr.s_addr = INADDR_ANY;
+    target_socket_address.sin_port = htons(RECEIVER_PORT);
+
+    for (int i = 0; i < PERSISTENT_CLIENTS; i++) {
+        persistent_file_descriptors[i] = open_client(&target_socket_address);
+        if (persistent_file_descriptors[i] == -1) {
+            perror("\n\nconnect");
+            return 1;
+        }
+    }
+
+    uint64_t start_ns = now_ns(), end_ns = start_ns + (uint64_t) DURATION_MS * 1000000ULL;
+
+    for (uint64_t attempt_ns = start_ns; attempt_ns < end_ns; attempt_ns = now_ns()) {
+        // New connection: connect, echo, close
+        ++attempts;
+
+        int client_file_descriptor = open_client(&target_socket_address);
+        if (client_file_descriptor == -1) {
+            ++connect_failures;
+        } else if (ping(client_file_descriptor) == -1) {
+            ++echo_failures;
+        } else {
+            uint64_t latency_ns = now_ns() - attempt_ns;
+
+            if (succeeded < MAX_ATTEMPTS) {
+                latencies[succeeded] = latency_ns;
+            }
+            ++succeeded; total_ns += latency_ns;
+
+            if (latency_ns > slowest_ns) {
+                slowest_ns = latency_ns; slowest_at_ns = attempt_ns - start_ns;
+            }
+        }
+        if (client_file_descriptor != -1) {
+            close(client_file_descriptor);
+        }
+
+        // Persistent connection, round robin
+        int *persistent = &persistent_file_descriptors[attempts % PERSISTENT_CLIENTS];
+        if (*persistent != -1) {
+            ++pings;
+            if (ping(*persistent) == -1) {
+                ++ping_failures;
+                close(*persistent); *persistent = -1;
+            }
+        }
+    }
+
+    size_t recorded = succeeded < MAX_ATTEMPTS ? succeeded : MAX_ATTEMPTS;
+    qsort(latencies, recorded, sizeof(uint64_t), compare_latency);
+
+    for (int i = 0; i < PERSISTENT_CLIENTS; i++) {
+        if (persistent_file_descriptors[i] != -1) {
+            ++survived;
+            close(persistent_file_descriptors[i]);
+        }
+    }
+
+    printf("Attempts: %zu, succeeded: %zu\n", attempts, succeeded);
+    printf("Failed connects: %zu, failed echoes: %zu\n", connect_failures, echo_failures);
+    if (recorded != 0) {
+        printf("Latency avg: %.1f us, p50: %.1f us, p99: %.1f us, p99.9: %.1f us, max: %.1f us (at %.3f s)\n",
+               (double) total_ns / (double) succeeded / 1e3,
+               (double) latencies[recorded / 2] / 1e3,
+               (double) latencies[recorded * 99 / 100] / 1e3,
+               (double) latencies[recorded * 999 / 1000] / 1e3,
+               (double) slowest_ns / 1e3, (double) slowest_at_ns / 1e9);
+    }
+    printf("Persistent clients: %d, survived: %zu, pings: %zu, failed pings: %zu\n",
+           PERSISTENT_CLIENTS, survived, pings, ping_failures);
+
+    // Clean memory
+    free(persistent_file_descriptors);
+    free(latencies);
+
+    return 0;
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// Storm of new connections from this count of threads for this time
+#define THREADS 8
+#define DURATION_MS 3000
+// Limit of recorded latencies of every thread
+#define MAX_ATTEMPTS (1 << 18)
+// Attempt fails if response does not come back in this time
+#define TIMEOUT_MS 1000
+#define REQUEST_SIZE 16
+#define RESPONSE_SIZE 65536
+#define RECEIVER_PORT 54321
+
+// Results of one storm thread
+struct storm_state {
+    pthread_t thread;
+    const struct sockaddr_in *target_socket_address;
+    uint64_t *latencies;
+    size_t attempts;
+    size_t succeeded;
+    size_t connect_failures;
+    size_t response_failures;
+};
+
+uint64_t now_ns() {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+int compare_latency(const void* left, const void* right) {
+    uint64_t a = *(const uint64_t *) left, b = *(const uint64_t *) right;
+    return (a > b) - (a < b);
+}
+
+int open_client(const struct sockaddr_in* target_socket_address) {
+    // Declaration and assign timeouts
+    struct timeval timeout = { .tv_sec = TIMEOUT_MS / 1000, .tv_usec = (TIMEOUT_MS % 1000) * 1000 };
+    // Close with RST, otherwise TIME_WAIT of client side exhausts ephemeral ports
+    struct linger linger = { .l_onoff = 1, .l_linger = 0 };
+
+    int file_descriptor = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (file_descriptor == -1) {
+        perror("\n\nsocket");
+        exit(EXIT_FAILURE);
+    }
+
+    setsockopt(file_descriptor, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(file_descriptor, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    setsockopt(file_descriptor, SOL_SOCKET, SO_LINGER, &linger, sizeof(linger));
+
+    if (connect(
+            file_descriptor, (const struct sockaddr *) target_socket_address, sizeof(*target_socket_address)
+    ) == -1) {
+        close(file_descriptor);
+        return -1;
+    }
+
+    return file_descriptor;
+}
+
+// New connection for every request: connect, request, whole response, close
+void* storm(void* argument) {
+    struct storm_state *state = argument;
+
+    char request[REQUEST_SIZE] = {0};
+    char *response = malloc(RESPONSE_SIZE);
+    if (response == NULL) {
+        perror("\n\nmalloc");
+        exit(EXIT_FAILURE);
+    }
+    memset(request, 'q', sizeof(request));
+
+    uint64_t end_ns = now_ns() + (uint64_t) DURATION_MS * 1000000ULL;
+
+    for (uint64_t attempt_ns = now_ns(); attempt_ns < end_ns; attempt_ns = now_ns()) {
+        ++state->attempts;
+
+        int client_file_descriptor = open_client(state->target_socket_address);
+        if (client_file_descriptor == -1) {
+            ++state->connect_failures;
+            continue;
+        }
+
+        if (send(client_file_descriptor, request, sizeof(request), MSG_NOSIGNAL) != sizeof(request)
+            || recv(client_file_descriptor, response, RESPONSE_SIZE, MSG_WAITALL) != RESPONSE_SIZE) {
+            ++state->response_failures;
+        } else {
+            if (state->succeeded < MAX_ATTEMPTS) {
+                state->latencies[state->succeeded] = now_ns() - attempt_ns;
+            }
+            ++state->succeeded;
+        }
+
+        close(client_file_descriptor);
+    }
+
+    free(response);
+
+    return NULL;
+}
+
+int main() {
+    // Declaration and assign states of threads
+    struct storm_state states[THREADS] = {0};
+
+    // Declaration and assign statistics
+    size_t attempts = 0, succeeded = 0, recorded = 0, connect_failures = 0, response_failures = 0;
+
+    // Set latencies of successful attempts of all threads
+    uint64_t *latencies = calloc((size_t) THREADS * MAX_ATTEMPTS, sizeof(uint64_t));
+    if (latencies == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign target socket address
+    struct sockaddr_in target_socket_address = {0};
+
+    // Clean buffer
+    memset(&target_socket_address, 0, sizeof(target_socket_address));
+
+    // Set target socket address
+    target_socket_address.sin_family = PF_INET;
+    target_socket_address.sin_addr.s_addr = INADDR_ANY;
+    target_socket_address.sin_port = htons(RECEIVER_PORT);
+
+    uint64_t start_ns = now_ns();
+
+    for (int i = 0; i < THREADS; i++) {
+        states[i].target_socket_address = &target_socket_address;
+        states[i].latencies = latencies + (size_t) i * MAX_ATTEMPTS;
+
+        if (pthread_create(&states[i].thread, NULL, storm, &states[i]) != 0) {
+            fprintf(stderr, "\n\npthread_create: failed\n");
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(states[i].thread, NULL);
+
+        size_t thread_recorded = states[i].succeeded < MAX_ATTEMPTS ? states[i].succeeded : MAX_ATTEMPTS;
+
+        // Pack latencies of threads together for percentiles
+        memmove(latencies + recorded, states[i].latencies, thread_recorded * sizeof(uint64_t));
+
+        recorded += thread_recorded;
+        attempts += states[i].attempts;
+        succeeded += states[i].succeeded;
+        connect_failures += states[i].connect_failures;
+        response_failures += states[i].response_failures;
+    }
+
+    double elapsed_s = (double) (now_ns() - start_ns) / 1e9;
+
+    qsort(latencies, recorded, sizeof(uint64_t), compare_latency);
+
+    printf("Threads: %d, attempts: %zu, succeeded: %zu, %.0f connections/s\n",
+           THREADS, attempts, succeeded, (double) succeeded / elapsed_s);
+    printf("Failed connects: %zu, failed responses: %zu\n", connect_failures, response_failures);
+    if (recorded != 0) {
+        printf("Latency p50: %.1f us, p99: %.1f us, p99.9: %.1f us, max: %.1f us\n",
+               (double) latencies[recorded / 2] / 1e3,
+               (double) latencies[recorded * 99 / 100] / 1e3,
+               (double) latencies[recorded * 999 / 1000] / 1e3,
+               (double) latencies[recorded - 1] / 1e3);
+    }
+
+    // Clean memory
+    free(latencies);
+
+    return 0;
+}
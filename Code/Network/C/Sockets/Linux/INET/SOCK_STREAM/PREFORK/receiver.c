@@ -0,0 +1,425 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <poll.h>
+#include <errno.h>
+#include <stdio.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// Count of pre-forked workers, 0 - one per online CPU
+#define WORKERS 0
+// Count of connections served at the same time by one worker
+#define MAX_CLIENTS 1024
+#define BUFF_SIZE 65535
+// Exit after this count of completed connections, 0 - run until SIGINT/SIGTERM
+#define EXIT_AFTER_CONNECTIONS 0
+#define RECEIVER_PORT 54321
+
+// Report of worker, sent over its channel after every change
+struct worker_report {
+    uint32_t in_flight;
+    uint64_t completed;
+};
+
+// State of worker as seen by dispatcher
+struct worker {
+    pid_t pid;
+    int channel_file_descriptor;
+    uint64_t dispatched;
+    struct worker_report report;
+};
+
+// Set by signal handler to stop dispatcher
+volatile sig_atomic_t running = 1;
+
+void stop(int signal_number) {
+    (void) signal_number;
+    running = 0;
+}
+
+int send_descriptor(int channel_file_descriptor, int descriptor) {
+    // Declaration and assign one byte of data, SCM_RIGHTS needs data to travel with
+    char byte = 0;
+    // Declaration and assign input/output vector
+    struct iovec iov = { .iov_base = &byte, .iov_len = sizeof(byte) };
+    // Declaration and assign message header
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    // Set control buffer, aligned for cmsghdr
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control = {0};
+
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &descriptor, sizeof(int));
+
+    if (sendmsg(channel_file_descriptor, &message, 0) == -1) {
+        perror("\n\nsendmsg");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Returns received descriptor, 0 on closed channel, -1 on error
+int receive_descriptor(int channel_file_descriptor) {
+    // Declaration and assign one byte of data
+    char byte = 0;
+    // Declaration and assign input/output vector
+    struct iovec iov = { .iov_base = &byte, .iov_len = sizeof(byte) };
+    // Declaration and assign message header
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    // Set control buffer, aligned for cmsghdr
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control = {0};
+
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    ssize_t received = recvmsg(channel_file_descriptor, &message, MSG_CMSG_CLOEXEC);
+    if (received <= 0) {
+        if (received == -1) {
+            perror("\n\nrecvmsg");
+        }
+        return (int) received;
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        fprintf(stderr, "\n\nrecvmsg: no SCM_RIGHTS\n");
+        return -1;
+    }
+
+    int descriptor = -1;
+    memcpy(&descriptor, CMSG_DATA(cmsg), sizeof(int));
+
+    return descriptor;
+}
+
+int send_report(int channel_file_descriptor, const struct worker_report* report) {
+    // Dispatcher can be gone already, then report is dropped
+    if (send(channel_file_descriptor, report, sizeof(*report), MSG_NOSIGNAL) == -1 && errno != EPIPE) {
+        perror("\n\nsend");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Serve clients passed over channel until dispatcher closes channel
+int run_worker(int index, int channel_file_descriptor) {
+    // Set buffer for data receive
+    char *buffer = calloc((size_t) BUFF_SIZE, sizeof(char));
+    // Set poll vector, first entry is channel
+    struct pollfd *poll_descriptors = calloc(MAX_CLIENTS + 1, sizeof(struct pollfd));
+    if (buffer == NULL || poll_descriptors == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign count of watched descriptors
+    nfds_t count = 1;
+    // Declaration and assign statistics
+    uint64_t bytes = 0, rejected = 0;
+
+    // Declaration and assign report
+    struct worker_report report = {0};
+
+    poll_descriptors[0] = (struct pollfd) { .fd = channel_file_descriptor, .events = POLLIN };
+
+    while (poll_descriptors[0].fd != -1 || count > 1) {
+        if (poll(poll_descriptors, count, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("\n\npoll");
+            return 1;
+        }
+
+        // Serve ready clients, closed client is replaced by last entry
+        for (nfds_t i = 1; i < count;) {
+            if (poll_descriptors[i].revents == 0) {
+                i++;
+                continue;
+            }
+
+            ssize_t received = recv(poll_descriptors[i].fd, buffer, (size_t) BUFF_SIZE, 0);
+            if (received > 0) {
+                bytes += (uint64_t) received; i++;
+                continue;
+            }
+            if (received == -1 && errno == EINTR) {
+                continue;
+            }
+
+            close(poll_descriptors[i].fd);
+            poll_descriptors[i] = poll_descriptors[--count];
+
+            --report.in_flight; ++report.completed;
+            if (send_report(channel_file_descriptor, &report) == -1) {
+                return 1;
+            }
+        }
+
+        // Take new client
+        if (poll_descriptors[0].fd != -1 && poll_descriptors[0].revents != 0) {
+            int client_file_descriptor = receive_descriptor(channel_file_descriptor);
+            if (client_file_descriptor == -1) {
+                return 1;
+            }
+
+            if (client_file_descriptor == 0) {
+                // Dispatcher is gone, finish clients in flight
+                poll_descriptors[0].fd = -1;
+            } else if (count == MAX_CLIENTS + 1) {
+                close(client_file_descriptor); ++rejected;
+
+                ++report.completed;
+                if (send_report(channel_file_descriptor, &report) == -1) {
+                    return 1;
+                }
+            } else {
+                poll_descriptors[count++] = (struct pollfd) { .fd = client_file_descriptor, .events = POLLIN };
+                ++report.in_flight;
+            }
+        }
+    }
+
+    printf("Worker %d (pid %d): connections %lu, rejected %lu, bytes %lu\n", index, getpid(),
+           (unsigned long) report.completed, (unsigned long) rejected, (unsigned long) bytes);
+
+    // Close channel
+    close(channel_file_descriptor);
+
+    // Clean memory
+    free(poll_descriptors);
+    free(buffer);
+
+    return 0;
+}
+
+int main() {
+    // Declaration and assign count of workers
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = WORKERS != 0 ? WORKERS : (cpus < 1 ? 1 : (int) cpus);
+
+    // Set state of all workers
+    struct worker *worker_states = calloc((size_t) workers, sizeof(struct worker));
+    // Set poll vector, first entry is listening socket
+    struct pollfd *poll_descriptors = calloc((size_t) workers + 1, sizeof(struct pollfd));
+    if (worker_states == NULL || poll_descriptors == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+    // Declaration and assign socket option value
+    int enable = 1;
+
+    // Declaration and assign statistics
+    uint64_t accepted = 0, completed = 0;
+
+    // Declaration and assign socket address unix
+    struct sockaddr_in socket_address = {0};
+    // Declaration and assign signal action
+    struct sigaction action = {0};
+
+    // Clean buffer
+    memset(&socket_address, 0, sizeof(socket_address));
+    memset(&action, 0, sizeof(action));
+
+    // Create socket
+    socket_file_descriptor = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, IPPROTO_TCP);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    // Allow restart while old connections are in TIME_WAIT
+    if (setsockopt(socket_file_descriptor, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
+    // Set socket socket address
+    socket_address.sin_family = PF_INET;
+    socket_address.sin_addr.s_addr = INADDR_ANY;
+    socket_address.sin_port = htons(RECEIVER_PORT);
+
+    // Bind socket to address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    // Listen for incoming connections
+    if (listen(socket_file_descriptor, SOMAXCONN) == -1) {
+        perror("\n\nlisten");
+        return 1;
+    }
+
+    // Fork workers, every worker owns one end of its channel
+    for (int i = 0; i < workers; i++) {
+        int channel[2] = {-1, -1};
+
+        // Message boundaries keep descriptors and reports apart
+        if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, channel) == -1) {
+            perror("\n\nsocketpair");
+            return 1;
+        }
+
+        pid_t pid = fork();
+        if (pid == -1) {
+            perror("\n\nfork");
+            return 1;
+        }
+
+        if (pid == 0) {
+            // Worker stops when dispatcher closes channel, not on signal of terminal
+            signal(SIGINT, SIG_IGN);
+            signal(SIGTERM, SIG_IGN);
+
+            // Close descriptors of dispatcher
+            close(socket_file_descriptor);
+            for (int j = 0; j < i; j++) {
+                close(worker_states[j].channel_file_descriptor);
+            }
+            close(channel[0]);
+
+            exit(run_worker(i, channel[1]));
+        }
+
+        close(channel[1]);
+        worker_states[i] = (struct worker) { .pid = pid, .channel_file_descriptor = channel[0] };
+        poll_descriptors[i + 1] = (struct pollfd) { .fd = channel[0], .events = POLLIN };
+    }
+
+    poll_descriptors[0] = (struct pollfd) { .fd = socket_file_descriptor, .events = POLLIN };
+
+    // Stop dispatcher on SIGINT and SIGTERM
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    printf("Workers: %d, listening on port: %d\n", workers, RECEIVER_PORT);
+
+    while (running) {
+        if (poll(poll_descriptors, (nfds_t) workers + 1, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("\n\npoll");
+            return 1;
+        }
+
+        // Take reports, newest report of worker replaces older
+        for (int i = 0; i < workers; i++) {
+            if (poll_descriptors[i + 1].revents == 0) {
+                continue;
+            }
+
+            struct worker_report report = {0};
+            ssize_t received = recv(worker_states[i].channel_file_descriptor, &report, sizeof(report), 0);
+            if (received != sizeof(report)) {
+                fprintf(stderr, "\n\nrecv: worker %d is gone\n", i);
+                return 1;
+            }
+
+            completed += report.completed - worker_states[i].report.completed;
+            worker_states[i].report = report;
+        }
+
+#if EXIT_AFTER_CONNECTIONS != 0
+        if (completed >= EXIT_AFTER_CONNECTIONS) {
+            running = 0;
+        }
+#endif
+
+        if (poll_descriptors[0].revents == 0) {
+            continue;
+        }
+
+        int client_file_descriptor = accept4(socket_file_descriptor, NULL, NULL, SOCK_CLOEXEC);
+        if (client_file_descriptor == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            perror("\n\naccept4");
+            return 1;
+        }
+
+        // Choose least loaded worker, descriptors still in channel count as in flight
+        int chosen = 0;
+        uint64_t chosen_load = UINT64_MAX;
+        for (int i = 0; i < workers; i++) {
+            uint64_t load = worker_states[i].dispatched - worker_states[i].report.completed;
+            if (load < chosen_load) {
+                chosen = i; chosen_load = load;
+            }
+        }
+
+        if (send_descriptor(worker_states[chosen].channel_file_descriptor, client_file_descriptor) == -1) {
+            return 1;
+        }
+
+        // Worker holds its own copy now
+        close(client_file_descriptor);
+
+        ++worker_states[chosen].dispatched; ++accepted;
+    }
+
+    // Close channels, workers finish clients in flight and exit
+    for (int i = 0; i < workers; i++) {
+        close(worker_states[i].channel_file_descriptor);
+    }
+    for (int i = 0; i < workers; i++) {
+        waitpid(worker_states[i].pid, NULL, 0);
+    }
+
+    for (int i = 0; i < workers; i++) {
+        printf("Worker %d: dispatched %lu, last reported in flight %u\n",
+               i, (unsigned long) worker_states[i].dispatched, worker_states[i].report.in_flight);
+    }
+    printf("Accepted connections: %lu\n", (unsigned long) accepted);
+    printf("Completed connections: %lu\n", (unsigned long) completed);
+
+    // Close socket
+    close(socket_file_descriptor);
+
+    // Clean memory
+    free(poll_descriptors);
+    free(worker_states);
+
+    return 0;
+}
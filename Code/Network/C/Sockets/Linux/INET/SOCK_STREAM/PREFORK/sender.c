@@ -0,0 +1,94 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// Count of concurrent clients
+#define CLIENTS 256
+// Count of messages sent by every client
+#define MESSAGES 16
+#define RECEIVER_PORT 54321
+
+int main() {
+    // Set descriptors of all clients
+    int *client_file_descriptors = calloc(CLIENTS, sizeof(int));
+    if (client_file_descriptors == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign count of sent bytes
+    size_t bytes = 0;
+
+    // Declaration and assign target socket address unix
+    struct sockaddr_in target_socket_address = {0};
+
+    // Clean buffer
+    memset(&target_socket_address, 0, sizeof(target_socket_address));
+
+    // Set target socket address
+    target_socket_address.sin_family = PF_INET;
+    target_socket_address.sin_addr.s_addr = INADDR_ANY;
+    target_socket_address.sin_port = htons(RECEIVER_PORT);
+
+    // Open all connections, clients use ephemeral ports and stay alive at the same time
+    for (int i = 0; i < CLIENTS; i++) {
+        client_file_descriptors[i] = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (client_file_descriptors[i] == -1) {
+            perror("\n\nsocket");
+            return 1;
+        }
+
+        if (connect(
+                client_file_descriptors[i], (struct sockaddr *) &target_socket_address, sizeof(target_socket_address)
+        ) == -1) {
+            perror("\n\nconnect");
+            return 1;
+        }
+    }
+
+    printf("Connected clients: %d\n", CLIENTS);
+
+    // Send data, every round touches every client
+    const char* message = "Hello, receiver!";
+    for (int round = 0; round < MESSAGES; round++) {
+        for (int i = 0; i < CLIENTS; i++) {
+            ssize_t bytes_sent = send(client_file_descriptors[i], message, strlen(message), 0);
+            if (bytes_sent == -1) {
+                perror("\n\nsend");
+                return 1;
+            }
+            bytes += (size_t) bytes_sent;
+        }
+    }
+
+    printf("Message sent: %s\n", message);
+    printf("Sent bytes: %zu\n", bytes);
+
+    // Close sockets
+    for (int i = 0; i < CLIENTS; i++) {
+        close(client_file_descriptors[i]);
+    }
+
+    // Clean memory
+    free(client_file_descriptors);
+
+    return 0;
+}
@@ -21,6 +21,7 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 
 #define LOOP_BACK 1
 #define TIME_SIZE 20
@@ -76,7 +77,17 @@ int decode_timeval(struct timeval* timestamp) {
     return 0;
 }
 
-int process_cmsg(struct cmsghdr* cmsg) {
+// Coalesced buffer of UDP_GRO holds datagrams of one flow, every one but last is segment_size long
+void print_datagrams(const char* buffer, size_t length, size_t segment_size) {
+    for (size_t offset = 0, index = 0; offset < length; offset += segment_size, index++) {
+        size_t datagram_length = length - offset < segment_size ? length - offset : segment_size;
+
+        // Datagram is printed in place, without copy out of receive buffer
+        printf("Datagram %zu (%zu bytes): %.*s\n", index, datagram_length, (int) datagram_length, buffer + offset);
+    }
+}
+
+int process_cmsg(struct cmsghdr* cmsg, int* segment_size) {
     if (cmsg != NULL) {
         if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMP) {
             // Declaration and assign timeval
@@ -90,6 +101,12 @@ int process_cmsg(struct cmsghdr* cmsg) {
 
             return decode_timeval(timestamp);
         }
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            // Segment size of coalesced datagrams
+            memcpy(segment_size, CMSG_DATA(cmsg), sizeof(int));
+            printf("Segment size (UDP_GRO): %i\n", *segment_size);
+            return 0;
+        }
         printf("Total current cmsg length: %lu\n", (size_t) cmsg->cmsg_len);
     }
 
@@ -138,6 +155,13 @@ int main() {
         return 1;
     }
 
+    // Kernel coalesces datagrams of one flow, UDP_GRO control message carries segment size
+    int gro_option = 1;
+    if (setsockopt(socket_file_descriptor, SOL_UDP, UDP_GRO, &gro_option, sizeof(gro_option)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
     // Set socket socket address
     socket_address.sin6_family = PF_INET6;
 #if LOOP_BACK == 0
@@ -175,17 +199,25 @@ int main() {
     printf("iov_base_len: %lu\n", iov.iov_len);
     printf("Current iov length: %i\n\n", message.msg_iovlen);
 
+    // Declaration and assign segment size, it stays 0 when datagram was not coalesced
+    int segment_size = 0;
+
     // Handle received ancillary data
     struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
 
     while (cmsg != NULL) {
-        if (process_cmsg(cmsg) == -1) {
+        if (process_cmsg(cmsg, &segment_size) == -1) {
             fprintf(stderr, "Error message: Something went wrong with process cmsg!\n");
             exit(1);
         }
         cmsg = CMSG_NXTHDR(&message, cmsg);
     }
 
+    // Kernel coalesced datagrams of sender, split them back
+    if (segment_size > 0 && received > segment_size) {
+        print_datagrams(iov_buffer, (size_t) received, (size_t) segment_size);
+    }
+
     // Close socket
     close(socket_file_descriptor);
 
@@ -21,11 +21,14 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/udp.h>
 #include <linux/errqueue.h>
 #include <linux/net_tstamp.h>
 
+#include "monitor.h"
+#include "time_format.h"
+
 #define LOOP_BACK 1
-#define TIME_SIZE 20
 #define BUFF_SIZE 65535
 #define RECEIVER_PORT 54321
 
@@ -51,28 +54,15 @@ void debug_sock_v6(const socklen_t* address_size, const struct sockaddr_in6* add
     free(ip_str);
 }
 
-int decode_timespec(const struct timespec* timestamp) {
-    // Convert time_t to the broken-down time (struct tm)
-    struct tm *time_info = localtime(&timestamp->tv_sec);
-
-    // Print the time in the desired format
-    char *time_str = calloc((size_t) TIME_SIZE, sizeof(char));
-    if (time_str == NULL) {
-        perror("\n\ncalloc");
-        return -1;
-    }
+// Local time of last second, shared by every decode of receiver
+struct time_format time_format = {0};
 
-    strftime(time_str, (size_t) TIME_SIZE, "%Y-%m-%d %H:%M:%S", time_info);
-    printf("Timestamp (strftime - timespec): %s\n", time_str);
-
-    // Print the time in the manual format
-    printf("Timestamp (manually - timespec): %02d-%02d-%04d %02d:%02d:%02d.%06ld\n\n",
-           time_info->tm_mday, time_info->tm_mon + 1, time_info->tm_year + 1900,
-           time_info->tm_hour, time_info->tm_min, time_info->tm_sec, timestamp->tv_nsec);
+int decode_timespec(const struct timespec* timestamp) {
+    // Declaration and assign buffer of time, formatter renders date only when second changes
+    char time_str[TIME_FORMAT_SIZE] = {0};
 
-    // Clean memory
-    free(time_info);
-    free(time_str);
+    time_format_timespec(&time_format, timestamp, time_str, sizeof(time_str));
+    printf("Timestamp (time_format - timespec): %s\n\n", time_str);
 
     return 0;
 }
@@ -93,7 +83,17 @@ int decode_scm_timestamping(struct scm_timestamping* ts) {
     return 0;
 }
 
-int process_cmsg(struct cmsghdr* cmsg) {
+// Coalesced buffer of UDP_GRO holds datagrams of one flow, every one but last is segment_size long
+void print_datagrams(const char* buffer, size_t length, size_t segment_size) {
+    for (size_t offset = 0, index = 0; offset < length; offset += segment_size, index++) {
+        size_t datagram_length = length - offset < segment_size ? length - offset : segment_size;
+
+        // Datagram is printed in place, without copy out of receive buffer
+        printf("Datagram %zu (%zu bytes): %.*s\n", index, datagram_length, (int) datagram_length, buffer + offset);
+    }
+}
+
+int process_cmsg(struct cmsghdr* cmsg, int* segment_size) {
     if (cmsg != NULL) {
         if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
             // Declaration and assign timestamp
@@ -107,13 +107,48 @@ int process_cmsg(struct cmsghdr* cmsg) {
 
             return decode_scm_timestamping(ts);
         }
+        if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            // Segment size of coalesced datagrams
+            memcpy(segment_size, CMSG_DATA(cmsg), sizeof(int));
+            printf("Segment size (UDP_GRO): %i\n", *segment_size);
+            return 0;
+        }
         printf("Total current cmsg length: %lu\n", (size_t) cmsg->cmsg_len);
     }
 
     return 0;
 }
 
-int main() {
+// Only software stamp ts[0] is CLOCK_REALTIME, hardware one ts[2] runs on clock of device, message without it is skipped
+int stamp_scm_timestamping(const struct cmsghdr* cmsg, struct timespec* timestamp) {
+    // Declaration and assign timestamps
+    struct scm_timestamping ts = {0};
+
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING) {
+        return -1;
+    }
+
+    memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+    if (ts.ts[0].tv_sec == 0 && ts.ts[0].tv_nsec == 0) {
+        return -1;
+    }
+
+    *timestamp = ts.ts[0];
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Monitor receives until end and keeps latency of every message, otherwise one message is printed
+    int monitor = argc == 2 && strcmp(argv[1], "monitor") == 0;
+    if (argc > 2 || (argc == 2 && !monitor)) {
+        fprintf(stderr, "Usage: %s [monitor]\n", argv[0]);
+        return 1;
+    }
+
+    // Zone is read once, not on every stamp
+    time_format_init(&time_format);
+
     // Set buffer for data receive
     char *iov_buffer = calloc(BUFF_SIZE, sizeof(char));
     // Set control buffer for receive data
@@ -153,6 +188,13 @@ int main() {
         exit(EXIT_FAILURE);
     }
 
+    // Kernel coalesces datagrams of one flow, UDP_GRO control message carries segment size
+    int gro_option = 1;
+    if (setsockopt(socket_file_descriptor, SOL_UDP, UDP_GRO, &gro_option, sizeof(gro_option)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
     // Set socket socket address
     socket_address.sin6_family = PF_INET6;
 #if LOOP_BACK == 0
@@ -177,28 +219,45 @@ int main() {
             .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control_buffer, .msg_controllen = (size_t) BUFF_SIZE
     };
 
-    // Receive message with file descriptor
-    ssize_t received = recvmsg(socket_file_descriptor, &message, 0);
-    if (received == -1) {
-        perror("\n\nrecvmsg");
-        return 1;
-    }
+    // Declaration and assign ancillary data header
+    struct cmsghdr *cmsg = NULL;
+
+    if (monitor) {
+        if (monitor_latencies(socket_file_descriptor, &message, stamp_scm_timestamping) == -1) {
+            return 1;
+        }
+    } else {
+        // Receive message with file descriptor
+        ssize_t received = recvmsg(socket_file_descriptor, &message, 0);
+        if (received == -1) {
+            perror("\n\nrecvmsg");
+            return 1;
+        }
+
+        debug_sock_v6(&sender_message_address_size, (struct sockaddr_in6 *) &sender_message_address, "recvmsg");
+
+        printf("iov_base: %s\n", iov_buffer);
+        printf("iov_base_len: %lu\n", iov.iov_len);
+        printf("Current iov length: %i\n\n", message.msg_iovlen);
 
-    debug_sock_v6(&sender_message_address_size, (struct sockaddr_in6 *) &sender_message_address, "recvmsg");
+        // Declaration and assign segment size, it stays 0 when datagram was not coalesced
+        int segment_size = 0;
 
-    printf("iov_base: %s\n", iov_buffer);
-    printf("iov_base_len: %lu\n", iov.iov_len);
-    printf("Current iov length: %i\n\n", message.msg_iovlen);
+        // Handle received ancillary data
+        cmsg = CMSG_FIRSTHDR(&message);
 
-    // Handle received ancillary data
-    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+        while (cmsg != NULL) {
+            if (process_cmsg(cmsg, &segment_size) == -1) {
+                fprintf(stderr, "Error message: Something went wrong with process cmsg!\n");
+                exit(1);
+            }
+            cmsg = CMSG_NXTHDR(&message, cmsg);
+        }
 
-    while (cmsg != NULL) {
-        if (process_cmsg(cmsg) == -1) {
-            fprintf(stderr, "Error message: Something went wrong with process cmsg!\n");
-            exit(1);
+        // Kernel coalesced datagrams of sender, split them back
+        if (segment_size > 0 && received > segment_size) {
+            print_datagrams(iov_buffer, (size_t) received, (size_t) segment_size);
         }
-        cmsg = CMSG_NXTHDR(&message, cmsg);
     }
 
     // Close socket
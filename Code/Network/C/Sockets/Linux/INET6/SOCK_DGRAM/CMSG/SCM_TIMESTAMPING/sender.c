@@ -13,17 +13,135 @@
  * limitations under the License.
  */
 
+#include <time.h>
+#include <poll.h>
+#include <errno.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <string.h>
-#include <sys/socket.h>
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
 
 #define CONNECT 0
 #define LOOP_BACK 1
+// Count of messages to send, every one gets its own TX timestamp
+#define MESSAGES 8
+// Stop waiting TX timestamps after this time, pending socket error does not extend it
+#define ERRQUEUE_TIMEOUT_MS 1000
+#define CONTROL_SIZE 256
 #define SENDER_PORT 12345
 #define RECEIVER_PORT 54321
 
+// Time before send call of every message by OPT_ID
+struct timespec send_time[MESSAGES];
+// TX timestamp of every message by OPT_ID
+struct timespec tx_time[MESSAGES];
+// Count of collected TX timestamps
+size_t tx_timestamps = 0;
+
+int64_t timespec_diff_ns(const struct timespec* start, const struct timespec* end) {
+    return (int64_t) (end->tv_sec - start->tv_sec) * 1000000000 + (end->tv_nsec - start->tv_nsec);
+}
+
+int process_errqueue(struct msghdr* message) {
+    // Declaration and assign timestamp and extended error of one error queue message
+    struct scm_timestamping ts = {0};
+    struct sock_extended_err serr = {0};
+    int has_ts = 0, has_serr = 0;
+
+    // With OPT_TSONLY message carries SCM_TIMESTAMPING and IP_RECVERR, without payload
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(message); cmsg != NULL; cmsg = CMSG_NXTHDR(message, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(struct scm_timestamping));
+            has_ts = 1;
+        } else if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                   (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+            memcpy(&serr, CMSG_DATA(cmsg), sizeof(struct sock_extended_err));
+            has_serr = 1;
+        } else {
+            printf("Total current cmsg length: %lu\n", (size_t) cmsg->cmsg_len);
+        }
+    }
+
+    if (!has_ts || !has_serr || serr.ee_errno != ENOMSG || serr.ee_origin != SO_EE_ORIGIN_TIMESTAMPING) {
+        fprintf(stderr, "Unexpected error queue message: errno %u, origin %u\n", serr.ee_errno, serr.ee_origin);
+        return -1;
+    }
+
+    // OPT_ID puts number of send call into ee_data
+    if (serr.ee_info == SCM_TSTAMP_SND && serr.ee_data < MESSAGES) {
+        // Software timestamp is in ts[0]
+        tx_time[serr.ee_data] = ts.ts[0];
+        ++tx_timestamps;
+    }
+
+    return 0;
+}
+
+uint64_t now_ns() {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+int reap_timestamps(int socket_file_descriptor, int timeout_ms) {
+    // Declaration and assign control buffer and end of wait
+    char control_buffer[CONTROL_SIZE];
+    uint64_t deadline_ns = now_ns() + (uint64_t) timeout_ms * 1000000ULL;
+
+    while (1) {
+        uint64_t current_ns = now_ns();
+        int remaining_ms = current_ns >= deadline_ns ? 0 : (int) ((deadline_ns - current_ns + 999999) / 1000000);
+
+        // Error queue is readable when POLLERR is set
+        struct pollfd pfd = { .fd = socket_file_descriptor, .events = 0 };
+        int ready = poll(&pfd, 1, remaining_ms);
+        if (ready == -1) {
+            perror("\n\npoll");
+            return -1;
+        }
+        if (ready == 0) {
+            return 0;
+        }
+
+        // Init msghdr, error queue carries only control data
+        struct msghdr message = { .msg_control = control_buffer, .msg_controllen = sizeof(control_buffer) };
+
+        if (recvmsg(socket_file_descriptor, &message, MSG_ERRQUEUE) == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // POLLERR without error queue messages is socket error, ICMP error of connected socket.
+                // Reading it clears it, otherwise poll reports it again at once.
+                int error = 0;
+                socklen_t error_size = sizeof(error);
+                if (getsockopt(socket_file_descriptor, SOL_SOCKET, SO_ERROR, &error, &error_size) == -1) {
+                    perror("\n\ngetsockopt");
+                    return -1;
+                }
+                if (error != 0) {
+                    fprintf(stderr, "Socket error: %s\n", strerror(error));
+                }
+                if (remaining_ms == 0) {
+                    return 0;
+                }
+                continue;
+            }
+            perror("\n\nrecvmsg");
+            return -1;
+        }
+
+        if (process_errqueue(&message) == -1) {
+            return -1;
+        }
+
+        if (tx_timestamps == MESSAGES) {
+            return 0;
+        }
+    }
+}
+
 int main() {
     // Declaration and assign socket descriptor
     int socket_file_descriptor = -1;
@@ -43,6 +161,14 @@ int main() {
         return 1;
     }
 
+    // Request software TX timestamps on error queue, numbered by send call and without payload
+    int options = SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_TX_SOFTWARE |
+                  SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    if (setsockopt(socket_file_descriptor, SOL_SOCKET, SO_TIMESTAMPING, &options, sizeof(options)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
     // Set socket socket address
     socket_address.sin6_family = AF_INET6;
 #if LOOP_BACK == 0
@@ -79,19 +205,45 @@ int main() {
 
     // Send data
     const char* message = "Hello, receiver!";
+    for (int i = 0; i < MESSAGES; i++) {
+        // Software timestamps use CLOCK_REALTIME
+        clock_gettime(CLOCK_REALTIME, &send_time[i]);
 #if CONNECT == 0
-    ssize_t bytes_sent = sendto(socket_file_descriptor, message, strlen(message), 0,
-                                (struct sockaddr *) &target_socket_address, sizeof(target_socket_address));
+        ssize_t bytes_sent = sendto(socket_file_descriptor, message, strlen(message), 0,
+                                    (struct sockaddr *) &target_socket_address, sizeof(target_socket_address));
 #elif CONNECT == 1
-    ssize_t bytes_sent = send(socket_file_descriptor, message, strlen(message), 0);
+        ssize_t bytes_sent = send(socket_file_descriptor, message, strlen(message), 0);
 #endif
-    if (bytes_sent == -1) {
-        perror("\n\nsendto");
-        return 1;
+        if (bytes_sent == -1) {
+            perror("\n\nsendto");
+            return 1;
+        }
+
+        // Take already queued timestamps without blocking
+        if (reap_timestamps(socket_file_descriptor, 0) == -1) {
+            return 1;
+        }
     }
 
     printf("Message sent: %s\n", message);
 
+    // Wait rest of timestamps
+    if (tx_timestamps != MESSAGES && reap_timestamps(socket_file_descriptor, ERRQUEUE_TIMEOUT_MS) == -1) {
+        return 1;
+    }
+
+    // Print send path latency of every message
+    for (int i = 0; i < MESSAGES; i++) {
+        if (tx_time[i].tv_sec == 0 && tx_time[i].tv_nsec == 0) {
+            printf("Message %d: TX timestamp is missing\n", i);
+        } else {
+            printf("Message %d: send call to TX software timestamp: %lld ns\n",
+                   i, (long long) timespec_diff_ns(&send_time[i], &tx_time[i]));
+        }
+    }
+
+    printf("Collected TX timestamps: %zu/%d\n", tx_timestamps, MESSAGES);
+
     // Close socket
     close(socket_file_descriptor);
 
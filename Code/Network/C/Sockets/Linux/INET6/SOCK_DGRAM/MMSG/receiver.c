@@ -0,0 +1,184 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#define LOOP_BACK 1
+// Count of preallocated mmsghdr/iovec slots filled by one recvmmsg call
+#define VLEN 64
+// Size of one slot, datagrams bigger than slot are truncated (MSG_TRUNC)
+#define SLOT_SIZE 2048
+// Stop draining when socket is idle for this time after the first datagram
+#define IDLE_TIMEOUT_MS 1000
+#define RECEIVER_PORT 54321
+
+void debug_sock_v6(const socklen_t* address_size, const struct sockaddr_in6* address, char* from) {
+    printf("\nSender size (%s): %u\n", from, *address_size);
+    printf("Sender family (%s): %hu\n", from, address->sin6_family);
+    printf("Sender port (%s):: %hu\n", from, ntohs(address->sin6_port));
+    printf("Sender flow info (%s):: %hu\n", from, ntohs(address->sin6_flowinfo));
+
+    char *ip_str = calloc(INET6_ADDRSTRLEN, sizeof(char));
+    if (ip_str == NULL) {
+        perror("\n\ncalloc");
+        exit(EXIT_FAILURE);
+    }
+
+    inet_ntop(AF_INET6, &(address->sin6_addr), ip_str, INET6_ADDRSTRLEN);
+    printf("Sender address (%s): %s\n", from, ip_str);
+
+    printf("Sender flow info (%s):: %hu\n", from, ntohs(address->sin6_scope_id));
+    printf("\n");
+
+    // Clean memory
+    free(ip_str);
+}
+
+double elapsed_seconds(const struct timespec* start, const struct timespec* end) {
+    return (double) (end->tv_sec - start->tv_sec) + (double) (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main() {
+    // Set buffer for all slots of data receive
+    char *buffer = calloc((size_t) VLEN * SLOT_SIZE, sizeof(char));
+    // Set vector of message headers
+    struct mmsghdr *messages = calloc(VLEN, sizeof(struct mmsghdr));
+    // Set vector of input/output vectors
+    struct iovec *iovs = calloc(VLEN, sizeof(struct iovec));
+    // Set vector of sender addresses
+    struct sockaddr_storage *sender_addresses = calloc(VLEN, sizeof(struct sockaddr_storage));
+    if (buffer == NULL || messages == NULL || iovs == NULL || sender_addresses == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+
+    // Declaration and assign statistics
+    size_t packets = 0, bytes = 0, syscalls = 0, truncated = 0;
+
+    // Declaration and assign time of first and last received batch
+    struct timespec first_time = {0}, last_time = {0};
+    // Declaration and assign receive timeout
+    struct timeval timeout = { .tv_sec = IDLE_TIMEOUT_MS / 1000, .tv_usec = (IDLE_TIMEOUT_MS % 1000) * 1000 };
+    // Declaration and assign socket address unix
+    struct sockaddr_in6 socket_address = {0};
+
+    // Clean buffer
+    memset(&socket_address, 0, sizeof(socket_address));
+
+    // Create socket
+    socket_file_descriptor = socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    // Set socket socket address
+    socket_address.sin6_family = PF_INET6;
+#if LOOP_BACK == 0
+    socket_address.sin6_addr = in6addr_any;
+#elif LOOP_BACK == 1
+    socket_address.sin6_addr = in6addr_loopback;
+#endif
+    socket_address.sin6_port = htons(RECEIVER_PORT);
+
+    // Bind socket to socket address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    // Init slots, every mmsghdr owns one iovec and one sender address
+    for (int i = 0; i < VLEN; i++) {
+        iovs[i] = (struct iovec) { .iov_base = buffer + (size_t) i * SLOT_SIZE, .iov_len = (size_t) SLOT_SIZE };
+        messages[i].msg_hdr = (struct msghdr) {
+                .msg_name = &sender_addresses[i], .msg_namelen = sizeof(struct sockaddr_storage),
+                .msg_iov = &iovs[i], .msg_iovlen = 1
+        };
+    }
+
+    // Drain socket until it is idle
+    while (1) {
+        // Wait first datagram of batch, then take all queued without blocking
+        int received = recvmmsg(socket_file_descriptor, messages, VLEN, MSG_WAITFORONE, NULL);
+        if (received == -1) {
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && packets != 0) {
+                break;
+            }
+            perror("\n\nrecvmmsg");
+            return 1;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &last_time);
+
+        // First batch, print info about sender and set idle timeout
+        if (packets == 0) {
+            first_time = last_time;
+
+            debug_sock_v6(&messages[0].msg_hdr.msg_namelen, (struct sockaddr_in6 *) &sender_addresses[0], "recvmmsg");
+
+            if (setsockopt(socket_file_descriptor, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == -1) {
+                perror("\n\nsetsockopt");
+                return 1;
+            }
+        }
+
+        ++syscalls;
+
+        for (int i = 0; i < received; i++) {
+            bytes += messages[i].msg_len;
+            if (messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                ++truncated;
+            }
+
+            // Reset address length, kernel overwrites it
+            messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        }
+        packets += (size_t) received;
+    }
+
+    double seconds = elapsed_seconds(&first_time, &last_time);
+
+    printf("Received packets: %zu\n", packets);
+    printf("Received bytes: %zu\n", bytes);
+    printf("Truncated packets: %zu\n", truncated);
+    printf("Syscalls: %zu\n", syscalls);
+    printf("Syscalls/packet: %.4f\n", (double) syscalls / (double) packets);
+    printf("Elapsed (first to last batch): %.6f s\n", seconds);
+    if (seconds > 0) {
+        printf("Packets/sec: %.0f\n", (double) packets / seconds);
+    }
+
+    // Close socket
+    close(socket_file_descriptor);
+
+    // Clean memory
+    free(sender_addresses);
+    free(iovs);
+    free(messages);
+    free(buffer);
+
+    return 0;
+}
@@ -24,8 +24,10 @@
 #include <linux/errqueue.h>
 #include <linux/net_tstamp.h>
 
+#include "monitor.h"
+#include "time_format.h"
+
 #define LOOP_BACK 1
-#define TIME_SIZE 20
 #define BUFF_SIZE 65535
 #define RECEIVER_PORT 54321
 
@@ -51,28 +53,15 @@ void debug_sock_v6(const socklen_t* address_size, const struct sockaddr_in6* add
     free(ip_str);
 }
 
-int decode_timespec(const struct timespec* timestamp) {
-    // Convert time_t to the broken-down time (struct tm)
-    struct tm *time_info = localtime(&timestamp->tv_sec);
-
-    // Print the time in the desired format
-    char *time_str = calloc((size_t) TIME_SIZE, sizeof(char));
-    if (time_str == NULL) {
-        perror("\n\ncalloc");
-        return -1;
-    }
-
-    strftime(time_str, (size_t) TIME_SIZE, "%Y-%m-%d %H:%M:%S", time_info);
-    printf("Timestamp (strftime - timespec): %s\n", time_str);
+// Local time of last second, shared by every decode of receiver
+struct time_format time_format = {0};
 
-    // Print the time in the manual format
-    printf("Timestamp (manually - timespec): %02d-%02d-%04d %02d:%02d:%02d.%06ld\n\n",
-           time_info->tm_mday, time_info->tm_mon + 1, time_info->tm_year + 1900,
-           time_info->tm_hour, time_info->tm_min, time_info->tm_sec, timestamp->tv_nsec);
+int decode_timespec(const struct timespec* timestamp) {
+    // Declaration and assign buffer of time, formatter renders date only when second changes
+    char time_str[TIME_FORMAT_SIZE] = {0};
 
-    // Clean memory
-    free(time_info);
-    free(time_str);
+    time_format_timespec(&time_format, timestamp, time_str, sizeof(time_str));
+    printf("Timestamp (time_format - timespec): %s\n\n", time_str);
 
     return 0;
 }
@@ -113,7 +102,36 @@ int process_cmsg(struct cmsghdr* cmsg) {
     return 0;
 }
 
-int main() {
+// Only software stamp ts[0] is CLOCK_REALTIME, hardware one ts[2] runs on clock of device, message without it is skipped
+int stamp_scm_timestamping(const struct cmsghdr* cmsg, struct timespec* timestamp) {
+    // Declaration and assign timestamps
+    struct scm_timestamping ts = {0};
+
+    if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPING) {
+        return -1;
+    }
+
+    memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+    if (ts.ts[0].tv_sec == 0 && ts.ts[0].tv_nsec == 0) {
+        return -1;
+    }
+
+    *timestamp = ts.ts[0];
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Monitor receives until end and keeps latency of every message, otherwise one message is printed
+    int monitor = argc == 2 && strcmp(argv[1], "monitor") == 0;
+    if (argc > 2 || (argc == 2 && !monitor)) {
+        fprintf(stderr, "Usage: %s [monitor]\n", argv[0]);
+        return 1;
+    }
+
+    // Zone is read once, not on every stamp
+    time_format_init(&time_format);
+
     // Set buffer for data receive
     char *iov_buffer = calloc((size_t) BUFF_SIZE, sizeof(char));
     // Set control buffer for receive data
@@ -200,31 +218,43 @@ int main() {
             .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control_buffer, .msg_controllen = (size_t) BUFF_SIZE
     };
 
-    // Receive message with file descriptor
-    ssize_t received = recvmsg(client_file_descriptor, &message, 0);
-    if (received == -1) {
-        perror("\n\nrecvmsg");
-        return 1;
-    }
+    // Declaration and assign ancillary data header
+    struct cmsghdr *cmsg = NULL;
 
-    // Get sender address info from message
-    debug_sock_v6(&sender_message_address_size, (struct sockaddr_in6 *) &sender_message_address, "recvmsg");
+    if (monitor) {
+        if (monitor_latencies(client_file_descriptor, &message, stamp_scm_timestamping) == -1) {
+            return 1;
+        }
+    } else {
+        // Receive message with file descriptor
+        ssize_t received = recvmsg(client_file_descriptor, &message, 0);
+        if (received == -1) {
+            perror("\n\nrecvmsg");
+            return 1;
+        }
 
-    printf("iov_base: %s\n", iov_buffer);
-    printf("iov_base_len: %lu\n", iov.iov_len);
-    printf("Current iov length: %i\n\n", message.msg_iovlen);
+        // Get sender address info from message
+        debug_sock_v6(&sender_message_address_size, (struct sockaddr_in6 *) &sender_message_address, "recvmsg");
 
-    // Handle received ancillary data
-    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+        printf("iov_base: %s\n", iov_buffer);
+        printf("iov_base_len: %lu\n", iov.iov_len);
+        printf("Current iov length: %i\n\n", message.msg_iovlen);
 
-    while (cmsg != NULL) {
-        if (process_cmsg(cmsg) == -1) {
-            fprintf(stderr, "Error message: Something went wrong with process cmsg!\n");
-            exit(1);
+        // Handle received ancillary data
+        cmsg = CMSG_FIRSTHDR(&message);
+
+        while (cmsg != NULL) {
+            if (process_cmsg(cmsg) == -1) {
+                fprintf(stderr, "Error message: Something went wrong with process cmsg!\n");
+                exit(1);
+            }
+            cmsg = CMSG_NXTHDR(&message, cmsg);
         }
-        cmsg = CMSG_NXTHDR(&message, cmsg);
     }
 
+    // Drain rest of stream, sender waits ACK of every write
+    while (recv(client_file_descriptor, iov_buffer, (size_t) BUFF_SIZE, 0) > 0) {}
+
     // Close socket
     close(client_file_descriptor);
     close(socket_file_descriptor);
@@ -13,16 +13,157 @@
  * limitations under the License.
  */
 
+#include <time.h>
+#include <poll.h>
+#include <errno.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+#include "histogram.h"
 
 #define LOOP_BACK 1
+// 0 - send one message, 1 - attribute latency of every write to SCHED, SOFTWARE and ACK timestamps
+#define LATENCY_BREAKDOWN 0
+// Size of one write, OPT_ID of TCP is offset of last byte of write
+#define WRITE_SIZE 256
+// Count of writes
+#define WRITES 128
+// Stop waiting timestamps when error queue is idle for this time
+#define ERRQUEUE_TIMEOUT_MS 1000
+#define CONTROL_SIZE 256
 #define SENDER_PORT 12345
 #define RECEIVER_PORT 54321
 
+#if LATENCY_BREAKDOWN == 1
+// Timestamps of one write
+struct write_timestamps {
+    struct timespec call;
+    struct timespec sched;
+    struct timespec software;
+    struct timespec ack;
+};
+
+// Timestamps of every write by index
+struct write_timestamps writes[WRITES];
+// Index of first write without timestamp for every stage (SCM_TSTAMP_SND, SCM_TSTAMP_SCHED, SCM_TSTAMP_ACK)
+uint32_t next_unstamped[3] = {0};
+// Count of collected timestamps
+size_t collected = 0;
+
+// Stages are ordered, clock step backwards is counted as zero
+uint64_t timespec_diff_ns(const struct timespec* start, const struct timespec* end) {
+    int64_t diff = (int64_t) (end->tv_sec - start->tv_sec) * 1000000000 + (end->tv_nsec - start->tv_nsec);
+    return diff > 0 ? (uint64_t) diff : 0;
+}
+
+int timespec_is_set(const struct timespec* timestamp) {
+    return timestamp->tv_sec != 0 || timestamp->tv_nsec != 0;
+}
+
+int process_errqueue(struct msghdr* message) {
+    // Declaration and assign timestamp and extended error of one error queue message
+    struct scm_timestamping ts = {0};
+    struct sock_extended_err serr = {0};
+    int has_ts = 0, has_serr = 0;
+
+    // With OPT_TSONLY message carries SCM_TIMESTAMPING and IP_RECVERR, without payload
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(message); cmsg != NULL; cmsg = CMSG_NXTHDR(message, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(struct scm_timestamping));
+            has_ts = 1;
+        } else if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                   (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+            memcpy(&serr, CMSG_DATA(cmsg), sizeof(struct sock_extended_err));
+            has_serr = 1;
+        } else {
+            printf("Total current cmsg length: %lu\n", (size_t) cmsg->cmsg_len);
+        }
+    }
+
+    if (!has_ts || !has_serr || serr.ee_errno != ENOMSG || serr.ee_origin != SO_EE_ORIGIN_TIMESTAMPING) {
+        fprintf(stderr, "Unexpected error queue message: errno %u, origin %u\n", serr.ee_errno, serr.ee_origin);
+        return -1;
+    }
+
+    // OPT_ID of TCP is byte offset of last byte of write, writes coalesced into one packet get stamp only for last
+    // one, so stamp is applied to every earlier write of this stage without stamp
+    uint32_t index = serr.ee_data / WRITE_SIZE;
+    if (index >= WRITES) {
+        index = WRITES - 1;
+    }
+    if (serr.ee_info > SCM_TSTAMP_ACK) {
+        return 0;
+    }
+
+    // Software timestamp is in ts[0]
+    for (; next_unstamped[serr.ee_info] <= index; ++next_unstamped[serr.ee_info]) {
+        struct write_timestamps *current = &writes[next_unstamped[serr.ee_info]];
+
+        switch (serr.ee_info) {
+            case SCM_TSTAMP_SCHED:
+                current->sched = ts.ts[0];
+                break;
+            case SCM_TSTAMP_SND:
+                current->software = ts.ts[0];
+                break;
+            case SCM_TSTAMP_ACK:
+                current->ack = ts.ts[0];
+                break;
+        }
+        ++collected;
+    }
+
+    return 0;
+}
+
+int reap_timestamps(int socket_file_descriptor, int timeout_ms) {
+    // Declaration and assign control buffer
+    char control_buffer[CONTROL_SIZE];
+
+    while (1) {
+        // Error queue is readable when POLLERR is set
+        struct pollfd pfd = { .fd = socket_file_descriptor, .events = 0 };
+        int ready = poll(&pfd, 1, timeout_ms);
+        if (ready == -1) {
+            perror("\n\npoll");
+            return -1;
+        }
+        if (ready == 0) {
+            return 0;
+        }
+
+        // Init msghdr, error queue carries only control data
+        struct msghdr message = { .msg_control = control_buffer, .msg_controllen = sizeof(control_buffer) };
+
+        if (recvmsg(socket_file_descriptor, &message, MSG_ERRQUEUE) == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // POLLERR without error queue messages, connection is broken
+                return 0;
+            }
+            perror("\n\nrecvmsg");
+            return -1;
+        }
+
+        if (process_errqueue(&message) == -1) {
+            return -1;
+        }
+
+        // Three timestamps for every write
+        if (collected == (size_t) WRITES * 3) {
+            return 0;
+        }
+    }
+}
+#endif
+
 int main() {
     // Declaration and assign socket descriptor
     int socket_file_descriptor = -1;
@@ -75,6 +216,7 @@ int main() {
         return 1;
     }
 
+#if LATENCY_BREAKDOWN == 0
     // Send data
     const char* message = "Hello, receiver!";
     ssize_t bytes_sent = send(socket_file_descriptor, message, strlen(message), 0);
@@ -84,6 +226,89 @@ int main() {
     }
 
     printf("Message sent: %s\n", message);
+#elif LATENCY_BREAKDOWN == 1
+    // Every write leaves socket alone, without waiting for coalescing with next one
+    int nodelay_option = 1;
+    if (setsockopt(socket_file_descriptor, IPPROTO_TCP, TCP_NODELAY, &nodelay_option, sizeof(nodelay_option)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
+    // Request SCHED, SOFTWARE and ACK timestamps on error queue, numbered by byte offset and without payload.
+    // Set after connect, so OPT_ID counts from first byte of first write.
+    int options = SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_TX_SCHED | SOF_TIMESTAMPING_TX_SOFTWARE |
+                  SOF_TIMESTAMPING_TX_ACK | SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY;
+    if (setsockopt(socket_file_descriptor, SOL_SOCKET, SO_TIMESTAMPING, &options, sizeof(options)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
+    // Declaration and assign write buffer
+    char buffer[WRITE_SIZE];
+
+    // Fill write buffer
+    const char* message = "Hello, receiver!";
+    for (size_t i = 0; i < sizeof(buffer); i++) {
+        buffer[i] = message[i % strlen(message)];
+    }
+
+    // Send data
+    for (int i = 0; i < WRITES; i++) {
+        // Software timestamps use CLOCK_REALTIME
+        clock_gettime(CLOCK_REALTIME, &writes[i].call);
+
+        ssize_t bytes_sent = send(socket_file_descriptor, buffer, sizeof(buffer), MSG_NOSIGNAL);
+        if (bytes_sent == -1) {
+            perror("\n\nsend");
+            return 1;
+        }
+
+        // Take already queued timestamps without blocking
+        if (reap_timestamps(socket_file_descriptor, 0) == -1) {
+            return 1;
+        }
+    }
+
+    printf("Message sent: %s\n", message);
+
+    // Wait rest of timestamps, ACK ones come after round trip
+    if (collected != (size_t) WRITES * 3 && reap_timestamps(socket_file_descriptor, ERRQUEUE_TIMEOUT_MS) == -1) {
+        return 1;
+    }
+
+    // Declaration and assign histograms of every stage
+    struct histogram *queueing = histogram_create(), *sending = histogram_create(), *acking = histogram_create();
+    if (queueing == NULL || sending == NULL || acking == NULL) {
+        perror("\n\nhistogram_create");
+        return 1;
+    }
+
+    for (int i = 0; i < WRITES; i++) {
+        // Write call to packet scheduler: application and stack
+        if (timespec_is_set(&writes[i].sched)) {
+            histogram_record(queueing, timespec_diff_ns(&writes[i].call, &writes[i].sched));
+        }
+        // Packet scheduler to driver: qdisc and device queue
+        if (timespec_is_set(&writes[i].sched) && timespec_is_set(&writes[i].software)) {
+            histogram_record(sending, timespec_diff_ns(&writes[i].sched, &writes[i].software));
+        }
+        // Driver to acknowledgment of peer: network and peer
+        if (timespec_is_set(&writes[i].software) && timespec_is_set(&writes[i].ack)) {
+            histogram_record(acking, timespec_diff_ns(&writes[i].software, &writes[i].ack));
+        }
+    }
+
+    printf("Collected timestamps: %zu/%d\n", collected, WRITES * 3);
+
+    histogram_print(queueing, "Queueing latency, write -> SCHED (us)", 1e3, stdout);
+    histogram_print(sending, "Send latency, SCHED -> SOFTWARE (us)", 1e3, stdout);
+    histogram_print(acking, "ACK latency, SOFTWARE -> ACK (us)", 1e3, stdout);
+
+    // Clean memory
+    free(queueing);
+    free(sending);
+    free(acking);
+#endif
 
     // Close socket
     close(socket_file_descriptor);
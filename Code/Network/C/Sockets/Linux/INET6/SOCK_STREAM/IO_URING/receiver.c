@@ -0,0 +1,477 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <sys/syscall.h>
+#include <sys/resource.h>
+
+#include "uring.h"
+
+#define RECEIVER_PORT 54321
+#define LOOP_BACK 1
+#define QUEUE_DEPTH 256
+// Completions of connection storm arrive between two waits
+#define COMPLETION_DEPTH 16384
+// Pool of receive buffers shared by all connections
+#define BUFFER_GROUP 0
+#define BUFFER_COUNT 1024
+#define BUFFER_SIZE 2048
+// Every request of this size gets response of that size
+#define REQUEST_SIZE 16
+#define RESPONSE_SIZE 65536
+// Upper bound of connection table when limit of descriptors is infinite
+#define MAX_CONNECTIONS (1 << 20)
+// Kind of operation in top byte of user_data, bytes of response sent before it below, descriptor in lower half
+#define TAG_SHIFT 56
+#define OFFSET_SHIFT 32
+#define OFFSET_MASK ((1U << (TAG_SHIFT - OFFSET_SHIFT)) - 1)
+
+// Kind of operation of completion
+enum operation_tag {
+    TAG_ACCEPT = 1,
+    TAG_RECEIVE = 2,
+    TAG_SEND = 3
+};
+
+// State of connection, indexed by descriptor
+struct connection {
+    // Bytes of request received so far
+    uint32_t received;
+    // Responses in kernel, descriptor is closed only after they complete
+    uint32_t sending;
+    // Zero copy notifications to come, kernel holds pages of response until them
+    uint32_t notifying;
+    // Receive is finished by end of stream or error
+    uint32_t closing;
+};
+
+// Set by signal handler to stop receiver
+volatile sig_atomic_t running = 1;
+
+void stop(int signal_number) {
+    (void) signal_number;
+    running = 0;
+}
+
+uint64_t now_ns() {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+// Raise limit of descriptors to hard limit, returns size of connection table
+size_t raise_file_limit() {
+    // Declaration and assign limit of descriptors
+    struct rlimit limit = {0};
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\ngetrlimit");
+        exit(EXIT_FAILURE);
+    }
+
+    // Soft limit can be raised up to hard limit without privileges
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\nsetrlimit");
+        exit(EXIT_FAILURE);
+    }
+
+    return limit.rlim_cur == RLIM_INFINITY || limit.rlim_cur > MAX_CONNECTIONS
+           ? MAX_CONNECTIONS : (size_t) limit.rlim_cur;
+}
+
+// Take submission entry of operation on descriptor, NULL when kernel does not take full ring
+struct io_uring_sqe* queue_operation(struct uring* ring, enum operation_tag tag, int fd) {
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (sqe == NULL) {
+        return NULL;
+    }
+
+    sqe->fd = fd;
+    sqe->user_data = (uint64_t) tag << TAG_SHIFT | (uint32_t) fd;
+
+    return sqe;
+}
+
+// Give receive buffer back to kernel
+void recycle_buffer(struct io_uring_buf_ring* buffer_ring, char* buffers, unsigned short* tail, unsigned short bid) {
+    struct io_uring_buf *buffer = &buffer_ring->bufs[*tail & (BUFFER_COUNT - 1)];
+
+    buffer->addr = (uint64_t) (uintptr_t) (buffers + (size_t) bid * BUFFER_SIZE);
+    buffer->len = BUFFER_SIZE;
+    buffer->bid = bid;
+
+    ++*tail;
+    __atomic_store_n(&buffer_ring->tail, *tail, __ATOMIC_RELEASE);
+}
+
+// One accept entry returns every new connection while it has IORING_CQE_F_MORE
+int arm_accept(struct uring* ring, int listener) {
+    struct io_uring_sqe *sqe = queue_operation(ring, TAG_ACCEPT, listener);
+    if (sqe == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+
+    return 0;
+}
+
+int arm_receive(struct uring* ring, int fd) {
+    struct io_uring_sqe *sqe = queue_operation(ring, TAG_RECEIVE, fd);
+    if (sqe == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+
+    return 0;
+}
+
+// Response is registered buffer, zero copy send pins no pages per request, offset skips bytes sent already
+int queue_response(struct uring* ring, int fd, const char* response, uint32_t offset, int zero_copy) {
+    struct io_uring_sqe *sqe = queue_operation(ring, TAG_SEND, fd);
+    if (sqe == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = zero_copy ? IORING_OP_SEND_ZC : IORING_OP_SEND;
+    sqe->addr = (uint64_t) (uintptr_t) (response + offset);
+    sqe->len = RESPONSE_SIZE - offset;
+    sqe->user_data |= (uint64_t) offset << OFFSET_SHIFT;
+    // MSG_WAITALL makes io_uring retry short send instead of completing it
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+
+    if (zero_copy) {
+        sqe->ioprio = IORING_RECVSEND_FIXED_BUF | IORING_SEND_ZC_REPORT_USAGE;
+        sqe->buf_index = 0;
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Declaration and assign send of responses, usage: receiver [zc|send]
+    int zero_copy = 1;
+    if (argc > 1 && strcmp(argv[1], "send") == 0) {
+        zero_copy = 0;
+    } else if (argc > 1 && strcmp(argv[1], "zc") != 0) {
+        fprintf(stderr, "Usage: %s [zc|send]\n", argv[0]);
+        return 1;
+    }
+
+    // Declaration and assign signal action
+    struct sigaction action = {0};
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+    int enable = 1;
+
+    // Declaration and assign instance of io_uring and completion
+    struct uring ring = {0};
+    struct io_uring_cqe cqe = {0};
+
+    // Declaration and assign socket address
+    struct sockaddr_in6 socket_address = {0};
+
+    // Declaration and assign statistics
+    uint64_t accepted = 0, accept_submissions = 0, open = 0, peak = 0, requests = 0, responses = 0;
+    uint64_t bytes = 0, notifications = 0, copied = 0, starved = 0, failures = 0, first_ns = 0, last_ns = 0;
+
+    size_t max_connections = raise_file_limit();
+
+    struct connection *connections = calloc(max_connections, sizeof(struct connection));
+    // Response is never changed, all zero copy sends share it
+    char *response = malloc(RESPONSE_SIZE);
+    char *buffers = malloc((size_t) BUFFER_COUNT * BUFFER_SIZE);
+    if (connections == NULL || response == NULL || buffers == NULL) {
+        perror("\n\nmalloc");
+        return 1;
+    }
+    memset(response, 'r', RESPONSE_SIZE);
+
+    if (uring_setup(&ring, QUEUE_DEPTH, COMPLETION_DEPTH) == -1) {
+        perror("\n\nio_uring_setup");
+        return 1;
+    }
+
+    // Register response once for fixed buffer sends
+    struct iovec response_iov = { .iov_base = response, .iov_len = RESPONSE_SIZE };
+    if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_BUFFERS, &response_iov, 1) == -1) {
+        perror("\n\nio_uring_register");
+        return 1;
+    }
+
+    // Ring of receive buffers must be page aligned
+    size_t buffer_ring_size = BUFFER_COUNT * sizeof(struct io_uring_buf);
+    struct io_uring_buf_ring *buffer_ring = mmap(NULL, buffer_ring_size, PROT_READ | PROT_WRITE,
+                                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer_ring == MAP_FAILED) {
+        perror("\n\nmmap");
+        return 1;
+    }
+
+    struct io_uring_buf_reg registration = {
+            .ring_addr = (uint64_t) (uintptr_t) buffer_ring,
+            .ring_entries = BUFFER_COUNT,
+            .bgid = BUFFER_GROUP
+    };
+    if (syscall(__NR_io_uring_register, ring.fd, IORING_REGISTER_PBUF_RING, &registration, 1) == -1) {
+        perror("\n\nio_uring_register");
+        return 1;
+    }
+
+    unsigned short buffer_tail = 0;
+    for (unsigned short bid = 0; bid < BUFFER_COUNT; bid++) {
+        recycle_buffer(buffer_ring, buffers, &buffer_tail, bid);
+    }
+
+    // Create socket
+    socket_file_descriptor = socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    if (setsockopt(socket_file_descriptor, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
+    // Set socket address
+    socket_address.sin6_family = PF_INET6;
+#if LOOP_BACK == 0
+    socket_address.sin6_addr = in6addr_any;
+#elif LOOP_BACK == 1
+    socket_address.sin6_addr = in6addr_loopback;
+#endif
+    socket_address.sin6_port = htons(RECEIVER_PORT);
+
+    // Bind socket to socket address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    // Listen input connections, storm of connects waits in backlog
+    if (listen(socket_file_descriptor, SOMAXCONN) == -1) {
+        perror("\n\nlisten");
+        return 1;
+    }
+
+    // Stop on Ctrl+C, wait of io_uring_enter is interrupted
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (arm_accept(&ring, socket_file_descriptor) == -1) {
+        perror("\n\nio_uring_enter");
+        return 1;
+    }
+    ++accept_submissions;
+
+    printf("Listening on port: %d, responses with %s\n", RECEIVER_PORT, zero_copy ? "IORING_OP_SEND_ZC" : "IORING_OP_SEND");
+
+    while (running) {
+        if (uring_enter(&ring, 1, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("\n\nio_uring_enter");
+            break;
+        }
+
+        while (uring_reap(&ring, &cqe)) {
+            enum operation_tag tag = (enum operation_tag) (cqe.user_data >> TAG_SHIFT);
+            int fd = (int) (uint32_t) cqe.user_data;
+
+            if (tag == TAG_ACCEPT) {
+                if (cqe.res >= 0 && (size_t) cqe.res >= max_connections) {
+                    close(cqe.res);
+                    ++failures;
+                } else if (cqe.res >= 0) {
+                    last_ns = now_ns();
+                    if (first_ns == 0) {
+                        first_ns = last_ns;
+                    }
+                    ++accepted;
+                    peak = ++open > peak ? open : peak;
+
+                    memset(&connections[cqe.res], 0, sizeof(struct connection));
+                    if (arm_receive(&ring, cqe.res) == -1) {
+                        perror("\n\nio_uring_enter");
+                        running = 0;
+                    }
+                } else {
+                    ++failures;
+                }
+
+                if (!(cqe.flags & IORING_CQE_F_MORE)) {
+                    if (arm_accept(&ring, socket_file_descriptor) == -1) {
+                        perror("\n\nio_uring_enter");
+                        running = 0;
+                    }
+                    ++accept_submissions;
+                }
+                continue;
+            }
+
+            struct connection *connection = &connections[fd];
+
+            if (tag == TAG_RECEIVE) {
+                if (cqe.res > 0) {
+                    connection->received += (uint32_t) cqe.res;
+
+                    // Data of request is not needed, buffer goes back to pool at once
+                    recycle_buffer(buffer_ring, buffers, &buffer_tail,
+                                   (unsigned short) (cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+
+                    for (; connection->received >= REQUEST_SIZE; connection->received -= REQUEST_SIZE) {
+                        ++requests;
+                        ++connection->sending;
+                        if (queue_response(&ring, fd, response, 0, zero_copy) == -1) {
+                            perror("\n\nio_uring_enter");
+                            running = 0;
+                            break;
+                        }
+                    }
+
+                    if (!(cqe.flags & IORING_CQE_F_MORE) && arm_receive(&ring, fd) == -1) {
+                        perror("\n\nio_uring_enter");
+                        running = 0;
+                    }
+                    continue;
+                }
+
+                if (cqe.res == -ENOBUFS) {
+                    ++starved;
+                    if (arm_receive(&ring, fd) == -1) {
+                        perror("\n\nio_uring_enter");
+                        running = 0;
+                    }
+                    continue;
+                }
+
+                // End of stream, reset or error finishes receive
+                connection->closing = 1;
+            } else if (tag == TAG_SEND && (cqe.flags & IORING_CQE_F_NOTIF)) {
+                // Kernel released pages of zero copy send
+                --connection->notifying;
+                ++notifications;
+                if ((uint32_t) cqe.res & IORING_NOTIF_USAGE_ZC_COPIED) {
+                    ++copied;
+                }
+            } else if (tag == TAG_SEND) {
+                uint32_t offset = (uint32_t) (cqe.user_data >> OFFSET_SHIFT) & OFFSET_MASK;
+
+                // Notification comes after every send which completes with IORING_CQE_F_MORE
+                if (cqe.flags & IORING_CQE_F_MORE) {
+                    ++connection->notifying;
+                }
+
+                if (cqe.res > 0) {
+                    bytes += (uint64_t) cqe.res;
+                    offset += (uint32_t) cqe.res;
+                }
+
+                // MSG_WAITALL completes short only when stream breaks, rest is sent and ends with its error
+                if (cqe.res > 0 && offset < RESPONSE_SIZE) {
+                    if (queue_response(&ring, fd, response, offset, zero_copy) == -1) {
+                        perror("\n\nio_uring_enter");
+                        running = 0;
+                    }
+                    continue;
+                }
+
+                --connection->sending;
+
+                if (cqe.res > 0) {
+                    ++responses;
+                } else {
+                    // Wake receive of broken connection, it finishes with end of stream
+                    ++failures;
+                    shutdown(fd, SHUT_RDWR);
+                }
+            }
+
+            // Descriptor number is reused by next accept, only after last completion of connection
+            if (connection->closing && connection->sending == 0 && connection->notifying == 0) {
+                close(fd);
+                memset(connection, 0, sizeof(struct connection));
+                --open;
+            }
+        }
+    }
+
+    double elapsed_s = (double) (last_ns - first_ns) / 1e9;
+
+    printf("\nConnections: %lu, accept submissions: %lu, peak open: %lu, still open: %lu\n",
+           (unsigned long) accepted, (unsigned long) accept_submissions, (unsigned long) peak, (unsigned long) open);
+    printf("Requests: %lu, responses: %lu, bytes: %lu, failures: %lu, receive pool empty: %lu\n",
+           (unsigned long) requests, (unsigned long) responses, (unsigned long) bytes,
+           (unsigned long) failures, (unsigned long) starved);
+    if (zero_copy) {
+        printf("Zero copy notifications: %lu, copied by kernel: %lu\n",
+               (unsigned long) notifications, (unsigned long) copied);
+    }
+    printf("System calls: %lu, connections per system call: %.2f, %.0f connections/s\n",
+           (unsigned long) ring.syscalls, (double) accepted / (double) ring.syscalls,
+           elapsed_s > 0 ? (double) accepted / elapsed_s : 0.0);
+
+    // Multishot accept holds listening socket after close, finish it so port is free at exit
+    shutdown(socket_file_descriptor, SHUT_RDWR);
+    for (int accepting = 1; accepting;) {
+        if (uring_enter(&ring, 1, -1) == -1 && errno != EINTR) {
+            break;
+        }
+        while (uring_reap(&ring, &cqe)) {
+            if ((cqe.user_data >> TAG_SHIFT) == TAG_ACCEPT && cqe.res >= 0) {
+                close(cqe.res);
+            }
+            if ((cqe.user_data >> TAG_SHIFT) == TAG_ACCEPT && !(cqe.flags & IORING_CQE_F_MORE)) {
+                accepting = 0;
+            }
+        }
+    }
+
+    // Close socket
+    close(socket_file_descriptor);
+
+    // Pending operations are cancelled with ring
+    uring_close(&ring);
+    munmap(buffer_ring, buffer_ring_size);
+
+    // Clean memory
+    free(connections);
+    free(response);
+    free(buffers);
+
+    return 0;
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#define LOOP_BACK 1
+#define BUFF_SIZE 65535
+#define RECEIVER_PORT 54321
+
+void debug_sock_v6(const socklen_t* address_size, const struct sockaddr_in6* address, char* from) {
+    printf("\nSender size (%s): %u\n", from, *address_size);
+    printf("Sender family (%s): %hu\n", from, address->sin6_family);
+    printf("Sender port (%s):: %hu\n", from, ntohs(address->sin6_port));
+    printf("Sender flow info (%s):: %hu\n", from, ntohs(address->sin6_flowinfo));
+
+    char *ip_str = calloc(INET6_ADDRSTRLEN, sizeof(char));
+    if (ip_str == NULL) {
+        perror("\n\ncalloc");
+        exit(EXIT_FAILURE);
+    }
+
+    inet_ntop(AF_INET6, &(address->sin6_addr), ip_str, INET6_ADDRSTRLEN);
+    printf("Sender address (%s): %s\n", from, ip_str);
+
+    printf("Sender flow info (%s):: %hu\n", from, ntohs(address->sin6_scope_id));
+    printf("\n");
+
+    // Clean memory
+    free(ip_str);
+}
+
+double elapsed_seconds(const struct timespec* start, const struct timespec* end) {
+    return (double) (end->tv_sec - start->tv_sec) + (double) (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int main() {
+    // Set buffer for data receive
+    char *buffer = calloc((size_t) BUFF_SIZE, sizeof(char));
+    if (buffer == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+    // Declaration and assign client descriptor
+    int client_file_descriptor = -1;
+    // Declaration and assign sender address struct size
+    socklen_t sender_address_size = sizeof(struct sockaddr_storage);
+    // Declaration and assign count of received bytes
+    size_t bytes = 0;
+
+    // Declaration and assign time of start and end of receive
+    struct timespec start_time = {0}, end_time = {0};
+    // Declaration and assign socket address unix
+    struct sockaddr_in6 socket_address = {0};
+    // Declaration and assign client socket address
+    struct sockaddr_storage sender_address = {0};
+
+    // Clean buffer
+    memset(&sender_address, 0, sizeof(sender_address));
+    memset(&socket_address, 0, sizeof(socket_address));
+
+    // Create socket
+    socket_file_descriptor = socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    // Set socket socket address
+    socket_address.sin6_family = PF_INET6;
+#if LOOP_BACK == 0
+    socket_address.sin6_addr = in6addr_any;
+#elif LOOP_BACK == 1
+    socket_address.sin6_addr = in6addr_loopback;
+#endif
+    socket_address.sin6_port = htons(RECEIVER_PORT);
+
+    // Bind socket to address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    // Listen for incoming connections
+    if (listen(socket_file_descriptor, 1) == -1) {
+        perror("\n\nlisten");
+        return 1;
+    }
+
+    // Accept incoming connection
+    client_file_descriptor = accept(socket_file_descriptor, (struct sockaddr *) &sender_address, &sender_address_size);
+    if (client_file_descriptor == -1) {
+        perror("\n\naccept");
+        return 1;
+    }
+
+    // Print info about sender
+    debug_sock_v6(&sender_address_size, (const struct sockaddr_in6 *) &sender_address, "accept");
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    // Receive data until sender closes connection
+    while (1) {
+        ssize_t received = recv(client_file_descriptor, buffer, (size_t) BUFF_SIZE, 0);
+        if (received == -1) {
+            perror("\n\nrecv");
+            return 1;
+        }
+        if (received == 0) {
+            break;
+        }
+        bytes += (size_t) received;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    double seconds = elapsed_seconds(&start_time, &end_time);
+
+    printf("Received bytes: %zu\n", bytes);
+    printf("Elapsed: %.6f s\n", seconds);
+    if (seconds > 0) {
+        printf("Throughput: %.2f MiB/s\n", (double) bytes / seconds / (1024.0 * 1024.0));
+    }
+
+    // Close sockets
+    close(client_file_descriptor);
+    close(socket_file_descriptor);
+
+    // Clean memory
+    free(buffer);
+
+    return 0;
+}
@@ -0,0 +1,289 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <poll.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+#define LOOP_BACK 1
+// Size of one send buffer
+#define BUFF_SIZE (4 * 1024 * 1024)
+// Count of send buffers, buffer is reused only after kernel released it
+#define BUFFERS 4
+// Count of buffers to send
+#define SENDS 256
+// Count of tracked send calls in flight, every call gets its own completion id
+#define MAX_CALLS 1024
+// ENOBUFS without calls in kernel waits this long before retry, send fails after this many retries
+#define ENOBUFS_RETRY_US 1000
+#define ENOBUFS_RETRIES 100
+#define CONTROL_SIZE 128
+#define SENDER_PORT 12345
+#define RECEIVER_PORT 54321
+
+// Buffer of every send call by completion id
+int call_buffer[MAX_CALLS];
+// Count of send calls not released by kernel for every buffer
+int buffer_calls[BUFFERS];
+
+// Statistics of completions
+size_t completions = 0, copied = 0, calls = 0, calls_released = 0;
+
+double elapsed_seconds(const struct timespec* start, const struct timespec* end) {
+    return (double) (end->tv_sec - start->tv_sec) + (double) (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+int process_cmsg(struct cmsghdr* cmsg) {
+    if (cmsg != NULL) {
+        if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+            (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+            // Declaration and assign extended error
+            struct sock_extended_err serr = {0};
+
+            memcpy(&serr, CMSG_DATA(cmsg), sizeof(struct sock_extended_err));
+
+            if (serr.ee_errno != 0 || serr.ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                fprintf(stderr, "Unexpected error queue message: errno %u, origin %u\n", serr.ee_errno, serr.ee_origin);
+                return -1;
+            }
+
+            // Kernel released send calls from ee_info to ee_data (inclusive)
+            for (uint32_t id = serr.ee_info; id != serr.ee_data + 1; id++) {
+                --buffer_calls[call_buffer[id % MAX_CALLS]];
+                ++calls_released;
+            }
+
+            // Kernel could not avoid copy (loopback, unsupported device)
+            if (serr.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) {
+                ++copied;
+            }
+            ++completions;
+            return 0;
+        }
+        printf("Total current cmsg length: %lu\n", (size_t) cmsg->cmsg_len);
+    }
+
+    return 0;
+}
+
+int reap_completions(int socket_file_descriptor, int wait) {
+    // Declaration and assign control buffer
+    char control_buffer[CONTROL_SIZE];
+
+    while (1) {
+        if (wait) {
+            // Error queue is readable when POLLERR is set
+            struct pollfd pfd = { .fd = socket_file_descriptor, .events = 0 };
+            if (poll(&pfd, 1, -1) == -1) {
+                perror("\n\npoll");
+                return -1;
+            }
+        }
+
+        // Init msghdr, error queue carries only control data
+        struct msghdr message = { .msg_control = control_buffer, .msg_controllen = sizeof(control_buffer) };
+
+        if (recvmsg(socket_file_descriptor, &message, MSG_ERRQUEUE) == -1) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            perror("\n\nrecvmsg");
+            return -1;
+        }
+
+        // Handle received ancillary data
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+
+        while (cmsg != NULL) {
+            if (process_cmsg(cmsg) == -1) {
+                return -1;
+            }
+            cmsg = CMSG_NXTHDR(&message, cmsg);
+        }
+
+        // After first completion take only already queued ones
+        wait = 0;
+    }
+}
+
+int main() {
+    // Set send buffers
+    char *buffers = calloc((size_t) BUFFERS * BUFF_SIZE, sizeof(char));
+    if (buffers == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+    // Declaration and assign option value
+    int zerocopy_option = 1;
+    // Declaration and assign count of sent bytes
+    size_t bytes = 0;
+
+    // Declaration and assign time of start and end of send
+    struct timespec start_time = {0}, end_time = {0};
+    // Declaration and assign socket address unix
+    struct sockaddr_in6 socket_address = {0};
+    // Declaration and assign target socket address unix
+    struct sockaddr_in6 target_socket_address = {0};
+
+    // Clean buffer
+    memset(&socket_address, 0, sizeof(socket_address));
+    memset(&target_socket_address, 0, sizeof(target_socket_address));
+
+    // Create socket
+    socket_file_descriptor = socket(AF_INET6, SOCK_STREAM, IPPROTO_TCP);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    // Allow MSG_ZEROCOPY on socket
+    if (setsockopt(socket_file_descriptor, SOL_SOCKET, SO_ZEROCOPY, &zerocopy_option, sizeof(zerocopy_option)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
+    // Set socket socket address
+    socket_address.sin6_family = PF_INET6;
+#if LOOP_BACK == 0
+    socket_address.sin6_addr = in6addr_any;
+#elif LOOP_BACK == 1
+    socket_address.sin6_addr = in6addr_loopback;
+#endif
+    socket_address.sin6_port = htons(SENDER_PORT);
+
+    // Bind socket to socket address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    // Set target socket address
+    target_socket_address.sin6_family = PF_INET6;
+#if LOOP_BACK == 0
+    target_socket_address.sin6_addr = in6addr_any;
+#elif LOOP_BACK == 1
+    target_socket_address.sin6_addr = in6addr_loopback;
+#endif
+    target_socket_address.sin6_port = htons(RECEIVER_PORT);
+
+    // Connect to socket
+    if (connect(
+            socket_file_descriptor, (struct sockaddr *) &target_socket_address, sizeof(target_socket_address)
+    ) == -1) {
+        perror("\n\nconnect");
+        return 1;
+    }
+
+    // Fill send buffers
+    const char* message = "Hello, receiver!";
+    for (size_t i = 0; i < (size_t) BUFFERS * BUFF_SIZE; i++) {
+        buffers[i] = message[i % strlen(message)];
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+    // Send data
+    for (int i = 0; i < SENDS; i++) {
+        // Declaration and assign current buffer
+        int index = i % BUFFERS;
+        char *buffer = buffers + (size_t) index * BUFF_SIZE;
+
+        // Buffer is still pinned by kernel, wait its release
+        while (buffer_calls[index] != 0) {
+            if (reap_completions(socket_file_descriptor, 1) == -1) {
+                return 1;
+            }
+        }
+
+        for (size_t offset = 0, retries = 0; offset < (size_t) BUFF_SIZE;) {
+            // All completion ids are in use, wait release of oldest
+            while (calls - calls_released == MAX_CALLS) {
+                if (reap_completions(socket_file_descriptor, 1) == -1) {
+                    return 1;
+                }
+            }
+
+            ssize_t bytes_sent = send(socket_file_descriptor, buffer + offset, (size_t) BUFF_SIZE - offset, MSG_ZEROCOPY);
+            if (bytes_sent == -1) {
+                // Out of optmem for notifications, release some and retry
+                if (errno == ENOBUFS && calls != calls_released) {
+                    if (reap_completions(socket_file_descriptor, 1) == -1) {
+                        return 1;
+                    }
+                    continue;
+                }
+                // No completion will come, optmem is taken by something else, wait a while
+                if (errno == ENOBUFS && retries++ < ENOBUFS_RETRIES) {
+                    usleep(ENOBUFS_RETRY_US);
+                    continue;
+                }
+                perror("\n\nsend");
+                return 1;
+            }
+
+            // Every successful MSG_ZEROCOPY call gets next completion id
+            call_buffer[calls % MAX_CALLS] = index;
+            ++buffer_calls[index]; ++calls;
+
+            offset += (size_t) bytes_sent; bytes += (size_t) bytes_sent;
+            retries = 0;
+        }
+
+        // Take already queued completions without blocking
+        if (reap_completions(socket_file_descriptor, 0) == -1) {
+            return 1;
+        }
+    }
+
+    // Wait release of all buffers before free
+    while (calls_released != calls) {
+        if (reap_completions(socket_file_descriptor, 1) == -1) {
+            return 1;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+    double seconds = elapsed_seconds(&start_time, &end_time);
+
+    printf("Message sent: %s\n", message);
+    printf("Sent bytes: %zu\n", bytes);
+    printf("Send calls: %zu\n", calls);
+    printf("Completion notifications: %zu\n", completions);
+    printf("Notifications with copy fallback: %zu\n", copied);
+    printf("Elapsed: %.6f s\n", seconds);
+    if (seconds > 0) {
+        printf("Throughput: %.2f MiB/s\n", (double) bytes / seconds / (1024.0 * 1024.0));
+    }
+
+    // Close socket
+    close(socket_file_descriptor);
+
+    // Clean memory
+    free(buffers);
+
+    return 0;
+}
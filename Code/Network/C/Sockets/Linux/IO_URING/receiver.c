@@ -0,0 +1,729 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+#define F_UNIX 0
+#define RECEIVER_PORT 54321
+#define SOCKET_PATH "/tmp/RECEIVER"
+// Receives in flight at once and size of buffer of every receive
+#define BATCH 64
+#define RECEIVE_SIZE 65536
+#define QUEUE_DEPTH 128
+// Datagrams have no end of stream, receiver stops after silence
+#define IDLE_TIMEOUT_MS 1000
+#define CONTROL_SIZE CMSG_SPACE(sizeof(struct timespec))
+// Pool of multishot mode shared by all connections, kernel picks buffer for every receive
+#define BUFFER_GROUP 0
+#define BUFFER_COUNT 256
+#define BUFFER_SIZE 4096
+// Completions of many connections arrive between two waits
+#define COMPLETION_DEPTH 8192
+#define ACCEPT_TAG UINT64_MAX
+#define CANCEL_TAG (UINT64_MAX - 1)
+
+// Family, type and address of sockets of example
+struct target {
+    int family;
+    int type;
+    int protocol;
+    struct sockaddr_storage address;
+    socklen_t address_size;
+};
+
+// Buffers registered in kernel, shared by all connections of multishot mode
+struct buffer_pool {
+    struct io_uring_buf_ring *ring;
+    size_t ring_size;
+    char *buffers;
+    unsigned short tail;
+};
+
+// Backend of socket operations, blocking system calls or io_uring
+struct engine {
+    const char *name;
+    // Blocking system calls of data path, ring counts its own
+    uint64_t syscalls;
+    struct uring ring;
+    // Receive slots which are in kernel now
+    unsigned char posted[BATCH];
+    int (*accept)(struct engine* engine, int listener);
+    ssize_t (*receive)(struct engine* engine, int fd, struct msghdr* messages, size_t count,
+                       ssize_t* results, size_t* completed);
+};
+
+uint64_t now_ns() {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+// Parse "<inet|inet6|unix> <stream|dgram|seqpacket>" and set address of receiver
+int parse_target(int argc, char* argv[], struct target* target) {
+    if (argc < 3) {
+        return -1;
+    }
+
+    if (strcmp(argv[2], "stream") == 0) {
+        target->type = SOCK_STREAM;
+    } else if (strcmp(argv[2], "dgram") == 0) {
+        target->type = SOCK_DGRAM;
+    } else if (strcmp(argv[2], "seqpacket") == 0) {
+        target->type = SOCK_SEQPACKET;
+    } else {
+        return -1;
+    }
+
+    memset(&target->address, 0, sizeof(target->address));
+
+    if (strcmp(argv[1], "inet") == 0) {
+        struct sockaddr_in *address = (struct sockaddr_in *) &target->address;
+
+        address->sin_family = PF_INET;
+        address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address->sin_port = htons(RECEIVER_PORT);
+
+        target->family = AF_INET;
+        target->address_size = sizeof(struct sockaddr_in);
+    } else if (strcmp(argv[1], "inet6") == 0) {
+        struct sockaddr_in6 *address = (struct sockaddr_in6 *) &target->address;
+
+        address->sin6_family = PF_INET6;
+        address->sin6_addr = in6addr_loopback;
+        address->sin6_port = htons(RECEIVER_PORT);
+
+        target->family = AF_INET6;
+        target->address_size = sizeof(struct sockaddr_in6);
+    } else if (strcmp(argv[1], "unix") == 0) {
+        struct sockaddr_un *address = (struct sockaddr_un *) &target->address;
+
+        address->sun_family = PF_UNIX;
+        strcpy(address->sun_path, SOCKET_PATH);
+
+        target->family = AF_UNIX;
+        target->address_size = sizeof(struct sockaddr_un);
+    } else {
+        return -1;
+    }
+
+    // Sequenced packets of INET need SCTP, which examples of this project do not cover
+    if (target->family != AF_UNIX && target->type == SOCK_SEQPACKET) {
+        return -1;
+    }
+
+    target->protocol = target->family == AF_UNIX ? F_UNIX
+                       : target->type == SOCK_STREAM ? IPPROTO_TCP : IPPROTO_UDP;
+
+    return 0;
+}
+
+// Wait of io_uring is repeated after signal, entries taken by kernel are not submitted again
+int engine_enter(struct engine* engine, unsigned wait, int timeout_ms) {
+    while (uring_enter(&engine->ring, wait, timeout_ms) == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Blocking calls and calls of io_uring_enter made by engine
+uint64_t engine_syscalls(const struct engine* engine) {
+    return engine->syscalls + engine->ring.syscalls;
+}
+
+int blocking_accept(struct engine* engine, int listener) {
+    ++engine->syscalls;
+    return accept(listener, NULL, NULL);
+}
+
+// First receive waits, rest of batch takes only what is queued already
+ssize_t blocking_receive(struct engine* engine, int fd, struct msghdr* messages, size_t count,
+                         ssize_t* results, size_t* completed) {
+    size_t received = 0;
+
+    while (received < count) {
+        size_t i = received;
+
+        ++engine->syscalls;
+
+        ssize_t length = recvmsg(fd, &messages[i], i == 0 ? 0 : MSG_DONTWAIT);
+        if (length == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Batch is drained, timeout of first receive is end of datagrams
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return -1;
+        }
+
+        results[i] = length;
+        completed[received++] = i;
+
+        // End of stream
+        if (length == 0) {
+            break;
+        }
+    }
+
+    return (ssize_t) received;
+}
+
+int uring_accept(struct engine* engine, int listener) {
+    // Declaration and assign completion
+    struct io_uring_cqe cqe = {0};
+
+    struct io_uring_sqe *sqe = uring_get_sqe(&engine->ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listener;
+
+    if (engine_enter(engine, 1, -1) == -1 || !uring_reap(&engine->ring, &cqe)) {
+        return -1;
+    }
+
+    if (cqe.res < 0) {
+        errno = -cqe.res;
+        return -1;
+    }
+
+    return cqe.res;
+}
+
+// Slots stay in kernel between calls, only completed slots are posted again
+ssize_t uring_receive(struct engine* engine, int fd, struct msghdr* messages, size_t count,
+                      ssize_t* results, size_t* completed) {
+    // Declaration and assign completion
+    struct io_uring_cqe cqe = {0};
+    size_t received = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!engine->posted[i]) {
+            struct io_uring_sqe *sqe = uring_get_sqe(&engine->ring);
+
+            if (sqe == NULL) {
+                return -1;
+            }
+            sqe->opcode = IORING_OP_RECVMSG;
+            sqe->fd = fd;
+            sqe->addr = (uint64_t) (uintptr_t) &messages[i];
+            sqe->len = 1;
+            sqe->user_data = (uint64_t) i;
+
+            engine->posted[i] = 1;
+        }
+    }
+
+    if (engine_enter(engine, 1, IDLE_TIMEOUT_MS) == -1) {
+        // Timeout without completions is end of datagrams
+        return errno == ETIME ? 0 : -1;
+    }
+
+    while (uring_reap(&engine->ring, &cqe)) {
+        size_t i = (size_t) cqe.user_data;
+
+        engine->posted[i] = 0;
+        results[i] = cqe.res;
+        completed[received++] = i;
+    }
+
+    return (ssize_t) received;
+}
+
+int raise_file_limit() {
+    // Declaration and assign limit of descriptors
+    struct rlimit limit = {0};
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\ngetrlimit");
+        return -1;
+    }
+
+    // Soft limit can be raised up to hard limit without privileges
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\nsetrlimit");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Give buffer back to kernel, it is visible after tail is published
+void pool_recycle(struct buffer_pool* pool, unsigned short bid) {
+    struct io_uring_buf *buffer = &pool->ring->bufs[pool->tail & (BUFFER_COUNT - 1)];
+
+    buffer->addr = (uint64_t) (uintptr_t) (pool->buffers + (size_t) bid * BUFFER_SIZE);
+    buffer->len = BUFFER_SIZE;
+    buffer->bid = bid;
+
+    ++pool->tail;
+    __atomic_store_n(&pool->ring->tail, pool->tail, __ATOMIC_RELEASE);
+}
+
+int pool_setup(struct engine* engine, struct buffer_pool* pool) {
+    // Ring of buffers must be page aligned
+    pool->ring_size = BUFFER_COUNT * sizeof(struct io_uring_buf);
+    pool->ring = mmap(NULL, pool->ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pool->ring == MAP_FAILED) {
+        return -1;
+    }
+
+    pool->buffers = malloc((size_t) BUFFER_COUNT * BUFFER_SIZE);
+    if (pool->buffers == NULL) {
+        return -1;
+    }
+
+    struct io_uring_buf_reg registration = {
+            .ring_addr = (uint64_t) (uintptr_t) pool->ring,
+            .ring_entries = BUFFER_COUNT,
+            .bgid = BUFFER_GROUP
+    };
+
+    // Provided buffer ring is 5.19 and later
+    if (syscall(__NR_io_uring_register, engine->ring.fd, IORING_REGISTER_PBUF_RING, &registration, 1) == -1) {
+        return -1;
+    }
+
+    pool->tail = 0;
+    for (unsigned short bid = 0; bid < BUFFER_COUNT; bid++) {
+        pool_recycle(pool, bid);
+    }
+
+    return 0;
+}
+
+// One accept entry returns every new connection while it has IORING_CQE_F_MORE
+int arm_accept(struct engine* engine, int listener) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&engine->ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listener;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = ACCEPT_TAG;
+
+    return 0;
+}
+
+// Accept entry keeps listening socket alive after close until it is cancelled
+int cancel_accept(struct engine* engine) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&engine->ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = ACCEPT_TAG;
+    sqe->user_data = CANCEL_TAG;
+
+    return 0;
+}
+
+// One receive entry per connection, buffer is taken from pool only when data arrives
+int arm_receive(struct engine* engine, int fd) {
+    struct io_uring_sqe *sqe = uring_get_sqe(&engine->ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUFFER_GROUP;
+    sqe->user_data = (uint64_t) fd;
+
+    return 0;
+}
+
+// Serve all connections of stream with multishot accept and receive until they are closed
+int serve_multishot(struct engine* engine, int listener) {
+    // Declaration and assign pool and completion
+    struct buffer_pool pool = {0};
+    struct io_uring_cqe cqe = {0};
+
+    // Declaration and assign statistics
+    uint64_t accepted = 0, open = 0, peak = 0, receives = 0, bytes = 0, starved = 0, first_ns = 0, last_ns = 0;
+
+    if (pool_setup(engine, &pool) == -1) {
+        perror("\n\npool_setup");
+        return -1;
+    }
+
+    if (arm_accept(engine, listener) == -1) {
+        perror("\n\nio_uring_enter");
+        return -1;
+    }
+
+    uint64_t syscalls_before = engine_syscalls(engine);
+
+    for (;;) {
+        if (engine_enter(engine, 1, IDLE_TIMEOUT_MS) == -1) {
+            if (errno != ETIME) {
+                perror("\n\nio_uring_enter");
+                return -1;
+            }
+            // All connections are closed and nothing comes
+            if (accepted > 0 && open == 0) {
+                break;
+            }
+            continue;
+        }
+
+        while (uring_reap(&engine->ring, &cqe)) {
+            if (cqe.user_data == ACCEPT_TAG) {
+                if (cqe.res < 0) {
+                    errno = -cqe.res;
+                    perror("\n\naccept");
+                } else {
+                    ++accepted;
+                    peak = ++open > peak ? open : peak;
+                    if (arm_receive(engine, cqe.res) == -1) {
+                        perror("\n\nio_uring_enter");
+                        return -1;
+                    }
+                }
+                if (!(cqe.flags & IORING_CQE_F_MORE) && arm_accept(engine, listener) == -1) {
+                    perror("\n\nio_uring_enter");
+                    return -1;
+                }
+                continue;
+            }
+
+            int fd = (int) cqe.user_data;
+
+            if (cqe.res > 0) {
+                unsigned short bid = (unsigned short) (cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+
+                last_ns = now_ns();
+                if (first_ns == 0) {
+                    first_ns = last_ns;
+                }
+
+                ++receives;
+                bytes += (uint64_t) cqe.res;
+
+                // Data is consumed, buffer goes back to pool
+                pool_recycle(&pool, bid);
+
+                if (!(cqe.flags & IORING_CQE_F_MORE) && arm_receive(engine, fd) == -1) {
+                    perror("\n\nio_uring_enter");
+                    return -1;
+                }
+            } else if (cqe.res == -ENOBUFS) {
+                // Pool was empty, buffers are recycled above, receive again
+                ++starved;
+                if (arm_receive(engine, fd) == -1) {
+                    perror("\n\nio_uring_enter");
+                    return -1;
+                }
+            } else {
+                // End of stream or error ends connection
+                if (cqe.res < 0) {
+                    errno = -cqe.res;
+                    perror("\n\nrecv");
+                }
+                close(fd);
+                --open;
+            }
+        }
+    }
+
+    // Multishot accept holds listening socket after close, finish it so port is free at exit
+    // Without cancel in kernel there is nothing to wait for
+    for (int accepting = cancel_accept(engine) == 0; accepting;) {
+        if (engine_enter(engine, 1, IDLE_TIMEOUT_MS) == -1 && errno != ETIME && errno != EINTR) {
+            break;
+        }
+        while (uring_reap(&engine->ring, &cqe)) {
+            if (cqe.user_data == ACCEPT_TAG && cqe.res >= 0) {
+                close(cqe.res);
+            }
+            if (cqe.user_data == ACCEPT_TAG && !(cqe.flags & IORING_CQE_F_MORE)) {
+                accepting = 0;
+            }
+        }
+    }
+
+    double elapsed_ms = (double) (last_ns - first_ns) / 1e6;
+    uint64_t syscalls = engine_syscalls(engine) - syscalls_before;
+
+    printf("Connections: %lu, peak open: %lu\n", (unsigned long) accepted, (unsigned long) peak);
+    printf("Receives: %lu, bytes: %lu, pool empty: %lu\n",
+           (unsigned long) receives, (unsigned long) bytes, (unsigned long) starved);
+    printf("Buffer memory: %d KiB shared, own %d KiB buffer per connection would take %lu KiB\n",
+           BUFFER_COUNT * BUFFER_SIZE / 1024, RECEIVE_SIZE / 1024, (unsigned long) peak * RECEIVE_SIZE / 1024);
+    printf("System calls: %lu, receives per system call: %.2f\n",
+           (unsigned long) syscalls, (double) receives / (double) syscalls);
+    printf("Elapsed: %.3f ms, %.1f MiB/s\n", elapsed_ms,
+           elapsed_ms > 0 ? (double) bytes / 1048576.0 / (elapsed_ms / 1e3) : 0.0);
+
+    munmap(pool.ring, pool.ring_size);
+    free(pool.buffers);
+
+    return 0;
+}
+
+// Count timestamps of kernel in ancillary data of received message
+int count_timestamps(struct msghdr* message) {
+    int timestamps = 0;
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(message); cmsg != NULL; cmsg = CMSG_NXTHDR(message, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMPNS) {
+            ++timestamps;
+        }
+    }
+
+    return timestamps;
+}
+
+int main(int argc, char* argv[]) {
+    // Declaration and assign target and engine, usage: receiver <family> <type> [blocking|io_uring]
+    struct target target = {0};
+    struct engine engine = {
+            .name = "blocking",
+            .accept = blocking_accept,
+            .receive = blocking_receive
+    };
+
+    // Multishot serves many connections of stream, shared pool replaces buffer of every connection
+    int multishot = argc > 3 && strcmp(argv[3], "multishot") == 0;
+
+    if (parse_target(argc, argv, &target) == -1
+        || (argc > 3 && !multishot && strcmp(argv[3], "io_uring") != 0 && strcmp(argv[3], "blocking") != 0)
+        || (multishot && target.type != SOCK_STREAM)) {
+        fprintf(stderr, "Usage: %s <inet|inet6|unix> <stream|dgram|seqpacket> [blocking|io_uring]\n"
+                        "       %s <inet|inet6|unix> stream multishot\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    if (argc > 3 && strcmp(argv[3], "blocking") != 0) {
+        if (uring_setup(&engine.ring, QUEUE_DEPTH, COMPLETION_DEPTH) == -1) {
+            perror("\n\nio_uring_setup");
+            return 1;
+        }
+        // Timeout of wait ends datagrams after silence, 5.11 and later
+        if (!(engine.ring.features & IORING_FEAT_EXT_ARG)) {
+            errno = ENOSYS;
+            perror("\n\nio_uring_setup");
+            return 1;
+        }
+        engine.name = multishot ? "multishot" : "io_uring";
+        engine.accept = uring_accept;
+        engine.receive = uring_receive;
+    }
+
+    // Declaration and assign socket descriptors
+    int socket_file_descriptor = -1, data_file_descriptor = -1;
+    int enable = 1;
+
+    // Declaration and assign receive slots
+    struct msghdr messages[BATCH] = {0};
+    struct iovec iov[BATCH] = {0};
+    ssize_t results[BATCH] = {0};
+    size_t completed[BATCH] = {0};
+
+    // Remove socket
+    unlink(SOCKET_PATH);
+
+    // Create socket
+    socket_file_descriptor = socket(target.family, target.type, target.protocol);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    if (target.family != AF_UNIX
+        && setsockopt(socket_file_descriptor, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
+    // Bind socket to socket address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &target.address, target.address_size) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    if (target.type == SOCK_DGRAM) {
+        data_file_descriptor = socket_file_descriptor;
+    } else {
+        // Listen input connections
+        if (listen(socket_file_descriptor, multishot ? SOMAXCONN : 1) == -1) {
+            perror("\n\nlisten");
+            return 1;
+        }
+
+        if (multishot) {
+            printf("Receiving with %s engine\n", engine.name);
+
+            if (raise_file_limit() == -1 || serve_multishot(&engine, socket_file_descriptor) == -1) {
+                return 1;
+            }
+
+            close(socket_file_descriptor);
+            uring_close(&engine.ring);
+
+            if (target.family == AF_UNIX) {
+                unlink(SOCKET_PATH);
+            }
+
+            return 0;
+        }
+
+        // Accept incoming connection
+        data_file_descriptor = engine.accept(&engine, socket_file_descriptor);
+        if (data_file_descriptor == -1) {
+            perror("\n\naccept");
+            return 1;
+        }
+    }
+
+    char *buffers = calloc((size_t) BATCH, RECEIVE_SIZE);
+    char *control_buffers = calloc((size_t) BATCH, CONTROL_SIZE);
+    if (buffers == NULL || control_buffers == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    for (size_t i = 0; i < BATCH; i++) {
+        iov[i].iov_base = buffers + i * RECEIVE_SIZE;
+        iov[i].iov_len = RECEIVE_SIZE;
+        messages[i].msg_iov = &iov[i];
+        messages[i].msg_iovlen = 1;
+        messages[i].msg_control = control_buffers + i * CONTROL_SIZE;
+        messages[i].msg_controllen = CONTROL_SIZE;
+    }
+
+    // Timestamp of kernel comes with every message as ancillary data
+    if (setsockopt(data_file_descriptor, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
+    // Blocking receive of datagrams ends after silence too
+    struct timeval idle = { .tv_sec = IDLE_TIMEOUT_MS / 1000, .tv_usec = (IDLE_TIMEOUT_MS % 1000) * 1000 };
+    if (setsockopt(data_file_descriptor, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle)) == -1) {
+        perror("\n\nsetsockopt");
+        return 1;
+    }
+
+    // Parallel receives of byte stream complete in any order, stream keeps one in kernel
+    size_t slots = target.type == SOCK_STREAM ? 1 : BATCH;
+
+    printf("Receiving with %s engine\n", engine.name);
+
+    // Declaration and assign statistics
+    uint64_t receives = 0, bytes = 0, timestamps = 0, first_ns = 0, last_ns = 0;
+    uint64_t syscalls_before = engine_syscalls(&engine);
+
+    for (int end = 0; !end;) {
+        ssize_t count = engine.receive(&engine, data_file_descriptor, messages, slots, results, completed);
+        if (count == -1) {
+            perror("\n\nreceive");
+            return 1;
+        }
+
+        if (count == 0) {
+            break;
+        }
+
+        for (ssize_t k = 0; k < count; k++) {
+            size_t i = completed[k];
+
+            if (results[i] < 0) {
+                errno = (int) -results[i];
+                perror("\n\nrecvmsg");
+                return 1;
+            }
+
+            // End of stream
+            if (results[i] == 0) {
+                end = 1;
+                continue;
+            }
+
+            last_ns = now_ns();
+            if (first_ns == 0) {
+                first_ns = last_ns;
+            }
+
+            ++receives;
+            bytes += (uint64_t) results[i];
+            timestamps += (uint64_t) count_timestamps(&messages[i]);
+
+            // Kernel shrinks control length to received ancillary data
+            messages[i].msg_controllen = CONTROL_SIZE;
+        }
+    }
+
+    double elapsed_ms = (double) (last_ns - first_ns) / 1e6;
+
+    printf("Receives: %lu, bytes: %lu, timestamps: %lu\n",
+           (unsigned long) receives, (unsigned long) bytes, (unsigned long) timestamps);
+    printf("System calls: %lu, receives per system call: %.2f\n",
+           (unsigned long) (engine_syscalls(&engine) - syscalls_before),
+           (double) receives / (double) (engine_syscalls(&engine) - syscalls_before));
+    printf("Elapsed: %.3f ms, %.1f MiB/s\n", elapsed_ms,
+           elapsed_ms > 0 ? (double) bytes / 1048576.0 / (elapsed_ms / 1e3) : 0.0);
+
+    // Close socket
+    if (data_file_descriptor != socket_file_descriptor) {
+        close(data_file_descriptor);
+    }
+    close(socket_file_descriptor);
+
+    // Pending receives are cancelled with ring
+    if (engine.ring.ring != NULL) {
+        uring_close(&engine.ring);
+    }
+
+    // Clean memory
+    free(buffers);
+    free(control_buffers);
+
+    // Remove socket
+    if (target.family == AF_UNIX) {
+        unlink(SOCKET_PATH);
+    }
+
+    return 0;
+}
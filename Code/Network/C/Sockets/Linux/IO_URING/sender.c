@@ -0,0 +1,406 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <poll.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "uring.h"
+
+#define F_UNIX 0
+#define RECEIVER_PORT 54321
+#define SOCKET_PATH "/tmp/RECEIVER"
+// Sends submitted at once, count and size of messages
+#define BATCH 64
+#define MESSAGES 200000
+#define MESSAGE_SIZE 256
+#define QUEUE_DEPTH 128
+
+// Family, type and address of sockets of example
+struct target {
+    int family;
+    int type;
+    int protocol;
+    struct sockaddr_storage address;
+    socklen_t address_size;
+};
+
+// Backend of socket operations, blocking system calls or io_uring
+struct engine {
+    const char *name;
+    // Blocking system calls of data path, ring counts its own
+    uint64_t syscalls;
+    struct uring ring;
+    int (*connect)(struct engine* engine, int fd, const struct target* target);
+    int (*send)(struct engine* engine, int fd, struct msghdr* messages, size_t count, int ordered);
+};
+
+uint64_t now_ns() {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+// Parse "<inet|inet6|unix> <stream|dgram|seqpacket>" and set address of receiver
+int parse_target(int argc, char* argv[], struct target* target) {
+    if (argc < 3) {
+        return -1;
+    }
+
+    if (strcmp(argv[2], "stream") == 0) {
+        target->type = SOCK_STREAM;
+    } else if (strcmp(argv[2], "dgram") == 0) {
+        target->type = SOCK_DGRAM;
+    } else if (strcmp(argv[2], "seqpacket") == 0) {
+        target->type = SOCK_SEQPACKET;
+    } else {
+        return -1;
+    }
+
+    memset(&target->address, 0, sizeof(target->address));
+
+    if (strcmp(argv[1], "inet") == 0) {
+        struct sockaddr_in *address = (struct sockaddr_in *) &target->address;
+
+        address->sin_family = PF_INET;
+        address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address->sin_port = htons(RECEIVER_PORT);
+
+        target->family = AF_INET;
+        target->address_size = sizeof(struct sockaddr_in);
+    } else if (strcmp(argv[1], "inet6") == 0) {
+        struct sockaddr_in6 *address = (struct sockaddr_in6 *) &target->address;
+
+        address->sin6_family = PF_INET6;
+        address->sin6_addr = in6addr_loopback;
+        address->sin6_port = htons(RECEIVER_PORT);
+
+        target->family = AF_INET6;
+        target->address_size = sizeof(struct sockaddr_in6);
+    } else if (strcmp(argv[1], "unix") == 0) {
+        struct sockaddr_un *address = (struct sockaddr_un *) &target->address;
+
+        address->sun_family = PF_UNIX;
+        strcpy(address->sun_path, SOCKET_PATH);
+
+        target->family = AF_UNIX;
+        target->address_size = sizeof(struct sockaddr_un);
+    } else {
+        return -1;
+    }
+
+    // Sequenced packets of INET need SCTP, which examples of this project do not cover
+    if (target->family != AF_UNIX && target->type == SOCK_SEQPACKET) {
+        return -1;
+    }
+
+    target->protocol = target->family == AF_UNIX ? F_UNIX
+                       : target->type == SOCK_STREAM ? IPPROTO_TCP : IPPROTO_UDP;
+
+    return 0;
+}
+
+// Wait of io_uring is repeated after signal, entries taken by kernel are not submitted again
+int engine_enter(struct engine* engine, unsigned wait) {
+    while (uring_enter(&engine->ring, wait, -1) == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Blocking calls and calls of io_uring_enter made by engine
+uint64_t engine_syscalls(const struct engine* engine) {
+    return engine->syscalls + engine->ring.syscalls;
+}
+
+int raise_file_limit() {
+    // Declaration and assign limit of descriptors
+    struct rlimit limit = {0};
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\ngetrlimit");
+        return -1;
+    }
+
+    // Soft limit can be raised up to hard limit without privileges
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\nsetrlimit");
+        return -1;
+    }
+
+    return 0;
+}
+
+int blocking_connect(struct engine* engine, int fd, const struct target* target) {
+    ++engine->syscalls;
+    return connect(fd, (const struct sockaddr *) &target->address, target->address_size);
+}
+
+int blocking_send(struct engine* engine, int fd, struct msghdr* messages, size_t count, int ordered) {
+    (void) ordered;
+
+    for (size_t i = 0; i < count;) {
+        ++engine->syscalls;
+
+        // Blocking socket sends whole message or fails
+        if (sendmsg(fd, &messages[i], MSG_NOSIGNAL) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        ++i;
+    }
+
+    return 0;
+}
+
+int uring_connect(struct engine* engine, int fd, const struct target* target) {
+    // Declaration and assign completion
+    struct io_uring_cqe cqe = {0};
+
+    struct io_uring_sqe *sqe = uring_get_sqe(&engine->ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) &target->address;
+    sqe->off = target->address_size;
+
+    if (engine_enter(engine, 1) == -1 || !uring_reap(&engine->ring, &cqe)) {
+        return -1;
+    }
+
+    if (cqe.res < 0) {
+        errno = -cqe.res;
+        return -1;
+    }
+
+    return 0;
+}
+
+// Whole batch goes to kernel in one system call, linked sends keep order of stream
+int uring_send(struct engine* engine, int fd, struct msghdr* messages, size_t count, int ordered) {
+    // Declaration and assign completion and first error
+    struct io_uring_cqe cqe = {0};
+    int error = 0;
+    // Declaration and assign messages which are not sent yet
+    size_t pending[BATCH] = {0};
+    size_t pending_count = count;
+    int wait_writable = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        pending[i] = i;
+    }
+
+    while (pending_count > 0 && error == 0) {
+        size_t submitted = 0;
+
+        // Resend waits until peer has room again
+        if (wait_writable) {
+            struct io_uring_sqe *sqe = uring_get_sqe(&engine->ring);
+            if (sqe == NULL) {
+                return -1;
+            }
+
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->fd = fd;
+            sqe->poll32_events = POLLOUT;
+            sqe->flags = IOSQE_IO_LINK;
+            sqe->user_data = UINT64_MAX;
+            ++submitted;
+        }
+
+        for (size_t k = 0; k < pending_count; k++) {
+            struct io_uring_sqe *sqe = uring_get_sqe(&engine->ring);
+            if (sqe == NULL) {
+                return -1;
+            }
+
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = fd;
+            sqe->addr = (uint64_t) (uintptr_t) &messages[pending[k]];
+            sqe->len = 1;
+            // MSG_WAITALL makes io_uring retry short send of stream instead of completing it.
+            // Internal retry of AF_UNIX datagram after EAGAIN sends it empty, datagrams come back to us.
+            sqe->msg_flags = MSG_NOSIGNAL | (ordered ? MSG_WAITALL : MSG_DONTWAIT);
+            sqe->flags = ordered && k + 1 < pending_count ? IOSQE_IO_LINK : 0;
+            sqe->user_data = (uint64_t) pending[k];
+            ++submitted;
+        }
+
+        pending_count = 0;
+        wait_writable = 0;
+
+        for (size_t reaped = 0; reaped < submitted;) {
+            if (engine_enter(engine, (unsigned) (submitted - reaped)) == -1) {
+                return -1;
+            }
+
+            while (uring_reap(&engine->ring, &cqe)) {
+                ++reaped;
+
+                if (cqe.user_data == UINT64_MAX) {
+                    if (cqe.res < 0 && error == 0) {
+                        error = -cqe.res;
+                    }
+                } else if (cqe.res == -EAGAIN && !ordered) {
+                    pending[pending_count++] = (size_t) cqe.user_data;
+                    wait_writable = 1;
+                } else if (cqe.res < 0 && error == 0) {
+                    error = -cqe.res;
+                }
+            }
+        }
+    }
+
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Declaration and assign target and engine, usage: sender <family> <type> [blocking|io_uring] [connections]
+    struct target target = {0};
+    // Many connections of stream are for multishot receiver, batches go to them in turn
+    long connections = argc > 4 ? strtol(argv[4], NULL, 10) : 1;
+    struct engine engine = {
+            .name = "blocking",
+            .connect = blocking_connect,
+            .send = blocking_send
+    };
+
+    if (parse_target(argc, argv, &target) == -1
+        || (argc > 3 && strcmp(argv[3], "io_uring") != 0 && strcmp(argv[3], "blocking") != 0)
+        || connections < 1 || (connections > 1 && target.type != SOCK_STREAM)) {
+        fprintf(stderr, "Usage: %s <inet|inet6|unix> <stream|dgram|seqpacket> [blocking|io_uring] [connections]\n",
+                argv[0]);
+        return 1;
+    }
+
+    if (argc > 3 && strcmp(argv[3], "io_uring") == 0) {
+        if (uring_setup(&engine.ring, QUEUE_DEPTH, 0) == -1) {
+            perror("\n\nio_uring_setup");
+            return 1;
+        }
+        engine.name = "io_uring";
+        engine.connect = uring_connect;
+        engine.send = uring_send;
+    }
+
+    // Declaration and assign socket descriptors
+    int *socket_file_descriptors = calloc((size_t) connections, sizeof(int));
+    if (socket_file_descriptors == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    if (connections > 1 && raise_file_limit() == -1) {
+        return 1;
+    }
+
+    // Declaration and assign messages of batch, all point to one payload
+    struct msghdr messages[BATCH] = {0};
+    struct iovec iov = {0};
+
+    char *payload = calloc((size_t) MESSAGE_SIZE, sizeof(char));
+    if (payload == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+    memset(payload, 'x', (size_t) MESSAGE_SIZE);
+
+    iov.iov_base = payload;
+    iov.iov_len = MESSAGE_SIZE;
+
+    for (size_t i = 0; i < BATCH; i++) {
+        messages[i].msg_iov = &iov;
+        messages[i].msg_iovlen = 1;
+    }
+
+    for (long i = 0; i < connections; i++) {
+        // Create socket
+        socket_file_descriptors[i] = socket(target.family, target.type, target.protocol);
+        if (socket_file_descriptors[i] == -1) {
+            perror("\n\nsocket");
+            return 1;
+        }
+
+        // Connect to socket, datagram socket gets default destination
+        if (engine.connect(&engine, socket_file_descriptors[i], &target) == -1) {
+            perror("\n\nconnect");
+            return 1;
+        }
+    }
+
+    printf("Sending with %s engine over %ld connections\n", engine.name, connections);
+
+    uint64_t syscalls_before = engine_syscalls(&engine);
+    uint64_t start_ns = now_ns();
+
+    for (size_t sent = 0; sent < MESSAGES; sent += BATCH) {
+        size_t count = MESSAGES - sent < BATCH ? MESSAGES - sent : BATCH;
+
+        int fd = socket_file_descriptors[(sent / BATCH) % (size_t) connections];
+
+        if (engine.send(&engine, fd, messages, count, target.type != SOCK_DGRAM) == -1) {
+            perror("\n\nsend");
+            return 1;
+        }
+    }
+
+    double elapsed_ms = (double) (now_ns() - start_ns) / 1e6;
+    uint64_t syscalls = engine_syscalls(&engine) - syscalls_before;
+
+    printf("Messages: %d, bytes: %lu\n", MESSAGES, (unsigned long) MESSAGES * MESSAGE_SIZE);
+    printf("System calls: %lu, messages per system call: %.2f\n",
+           (unsigned long) syscalls, (double) MESSAGES / (double) syscalls);
+    printf("Elapsed: %.3f ms, %.0f messages/s\n", elapsed_ms, (double) MESSAGES / (elapsed_ms / 1e3));
+
+    // Close sockets
+    for (long i = 0; i < connections; i++) {
+        close(socket_file_descriptors[i]);
+    }
+
+    if (engine.ring.ring != NULL) {
+        uring_close(&engine.ring);
+    }
+
+    // Clean memory
+    free(payload);
+    free(socket_file_descriptors);
+
+    return 0;
+}
@@ -20,6 +20,8 @@
 #include <unistd.h>
 #include <string.h>
 #include <sys/uio.h>
+#include <stdint.h>
+#include <sys/resource.h>
 #include <sys/socket.h>
 
 // Linux Kernel combine all of cmsghdr and give size of sendmsg, recvmsg is equals <=100 bytes,
@@ -27,12 +29,24 @@
 
 #define ONE_CMSGHDR 1
 
+// Kernel limit of descriptors in one message (SCM_MAX_FD), bigger sets are split over messages
+#define MAX_DESCRIPTORS_PER_MESSAGE 253
+// Count of times every file is opened, 64 * 4 files need two messages
+#define REPEAT 64
+
 #define F_UNIX 0
 #define BUFF_SIZE 65535
 #define FP "../Test Files/"
 #define SOCKET_PATH "/tmp/SENDER"
 #define TARGET_SOCKET_PATH "/tmp/RECEIVER"
 
+// Header of every message, receiver reassembles descriptors by offset
+struct descriptor_chunk {
+    uint32_t total;
+    uint32_t offset;
+    uint32_t count;
+};
+
 char* concat(const char* str1, const char* str2) {
     // Alloc memory for new string
     char *result = calloc(strlen(str1) + strlen(str2) + 1, sizeof(char));
@@ -47,11 +61,9 @@ char* concat(const char* str1, const char* str2) {
     return result;
 }
 
-int* open_descriptors(char* folder_path, char** filenames, size_t* array_size) {
+int* open_descriptors(char* folder_path, char** filenames, int* file_fds, size_t* array_size) {
     // Declaration and assign current descriptor
     int fd = 0;
-    // Logical allocate address in heap for realloc without size
-    int *file_fds = NULL;
 
     // Iteration on filenames
     for (void *i = (void *) 1; i != NULL;) {
@@ -102,6 +114,119 @@ int* open_descriptors(char* folder_path, char** filenames, size_t* array_size) {
     return file_fds;
 }
 
+int raise_file_limit() {
+    // Declaration and assign limit of descriptors
+    struct rlimit limit = {0};
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\ngetrlimit");
+        return -1;
+    }
+
+    // Soft limit can be raised up to hard limit without privileges
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\nsetrlimit");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Send descriptors in messages of up to MAX_DESCRIPTORS_PER_MESSAGE, data of message travels with the first one
+ssize_t send_descriptors(int socket_file_descriptor, struct msghdr* message, const int* file_fds, size_t file_count) {
+    // Declaration and assign data of message, message is restored after send
+    struct iovec *data = message->msg_iov;
+    size_t data_count = message->msg_iovlen;
+    // Declaration and assign count of sent bytes
+    ssize_t send_size = 0;
+
+#if ONE_CMSGHDR == 0
+    // Calculate maximal length of control messages
+    size_t cmsg_total_size = MAX_DESCRIPTORS_PER_MESSAGE * CMSG_SPACE(sizeof(int));
+#elif ONE_CMSGHDR == 1
+    // Calculate maximal length of control messages with alignment
+    size_t cmsg_total_size = CMSG_SPACE(sizeof(int) * MAX_DESCRIPTORS_PER_MESSAGE);
+#endif
+
+    // Allocate memory for the control messages buffer
+    char *cmsgbuf = calloc(cmsg_total_size, sizeof(char));
+    if (cmsgbuf == NULL) {
+        perror("\n\ncalloc");
+        return -1;
+    }
+
+    size_t offset = 0;
+    do {
+        size_t count = file_count - offset < MAX_DESCRIPTORS_PER_MESSAGE
+                       ? file_count - offset : MAX_DESCRIPTORS_PER_MESSAGE;
+
+        // Declaration and assign header of message
+        struct descriptor_chunk chunk = {
+                .total = (uint32_t) file_count, .offset = (uint32_t) offset, .count = (uint32_t) count
+        };
+        // Declaration and assign input/output vector, header first, data only in the first message
+        struct iovec iov[2] = {
+                { .iov_base = &chunk, .iov_len = sizeof(chunk) },
+                { .iov_base = data[0].iov_base, .iov_len = offset == 0 ? data[0].iov_len : 0 }
+        };
+
+        // Clean buffer
+        memset(cmsgbuf, 0, cmsg_total_size);
+
+#if ONE_CMSGHDR == 0
+        // Populate the control messages
+        for (size_t i = 0; i < count; i++) {
+            struct cmsghdr *cmsg = (struct cmsghdr *) (cmsgbuf + i * CMSG_SPACE(sizeof(int)));
+
+            *cmsg = (struct cmsghdr) {
+                    .cmsg_len = CMSG_LEN(sizeof(int)), .cmsg_level = SOL_SOCKET, .cmsg_type = SCM_RIGHTS
+            };
+            memcpy(CMSG_DATA(cmsg), &file_fds[offset + i], sizeof(int));
+        }
+        size_t cmsg_size = count * CMSG_SPACE(sizeof(int));
+#elif ONE_CMSGHDR == 1
+        // Prepare the control message to send the file descriptors
+        struct cmsghdr *cmsg = (struct cmsghdr *) cmsgbuf;
+
+        *cmsg = (struct cmsghdr) {
+                .cmsg_len = CMSG_LEN(sizeof(int) * count), .cmsg_level = SOL_SOCKET, .cmsg_type = SCM_RIGHTS
+        };
+        memcpy(CMSG_DATA(cmsg), &file_fds[offset], sizeof(int) * count);
+        size_t cmsg_size = CMSG_SPACE(sizeof(int) * count);
+#endif
+
+        // Set the control message buffer and length in the message header, empty set has no control message
+        message->msg_control = count != 0 ? cmsgbuf : NULL;
+        message->msg_controllen = count != 0 ? cmsg_size : 0;
+        message->msg_iov = iov;
+        message->msg_iovlen = 2;
+
+        // Send the message with the file descriptors
+        ssize_t sent = sendmsg(socket_file_descriptor, message, 0);
+        if (sent == -1) {
+            perror("\n\nsendmsg");
+            free(cmsgbuf);
+            return -1;
+        }
+
+        printf("\nSent descriptors: %zu..%zu of %zu", offset, offset + count, file_count);
+
+        send_size += sent; offset += count;
+    } while (offset < file_count);
+
+    // Restore message
+    message->msg_iov = data;
+    message->msg_iovlen = data_count;
+    message->msg_control = NULL;
+    message->msg_controllen = 0;
+
+    // Clean memory
+    free(cmsgbuf);
+
+    return send_size;
+}
+
 int main() {
     // Remove socket
     unlink(SOCKET_PATH);
@@ -140,11 +265,20 @@ int main() {
             NULL
     };
 
-    // Array descriptors
-    int *file_fds = open_descriptors(FP, filenames, &file_count);
+    // Many descriptors can exceed default soft limit
+    if (raise_file_limit() == -1) {
+        return 1;
+    }
+
+    // Array descriptors, every file is opened REPEAT times
+    int *file_fds = NULL;
+    for (int i = 0; i < REPEAT; i++) {
+        file_fds = open_descriptors(FP, filenames, file_fds, &file_count);
+        printf("\n");
+    }
     printf("\n\nCount descriptors: %zu\n\n", file_count);
-    for (int i = 0; i < file_count; i++) {
-        if (!i) { printf("Index::Descriptor: %i::%i", i, file_fds[i]); } else { printf(", %i::%i", i, file_fds[i]); }
+    for (size_t i = 0; i < file_count; i++) {
+        if (!i) { printf("Index::Descriptor: %zu::%i", i, file_fds[i]); } else { printf(", %zu::%i", i, file_fds[i]); }
     }
 
     // Create socket.
@@ -180,79 +314,20 @@ int main() {
         .msg_iov = &iov, .msg_iovlen = 1
     };
 
-#if ONE_CMSGHDR == 0
-    // Calculate total length of control messages
-    size_t cmsg_total_size = 0;
-    for (int i = 0; i < file_count; i++) {
-        cmsg_total_size += CMSG_SPACE(sizeof(int));
-    }
-#elif ONE_CMSGHDR == 1
-    // Calculate total length of control messages with alignment
-    size_t cmsg_total_size = CMSG_SPACE(sizeof(int) * file_count);
-#endif
-
-    // Allocate memory for the control messages buffer
-    char *cmsgbuf = calloc(cmsg_total_size, sizeof(char));
-    if (cmsgbuf == NULL) {
-        perror("\n\ncalloc");
-        return 1;
-    }
-
-    // Initialize pointer to the current position in the control messages buffer
-    char *cmsg_ptr = cmsgbuf;
-
-#if ONE_CMSGHDR == 0
-    // Populate the control messages
-    for (int i = 0; i < file_count; i++) {
-        int file_fd = file_fds[i];
-
-        printf("\n\nPopulate the control messages: %i", i);
-
-        // Calculate the size of the current control message
-        size_t cmsg_size = CMSG_LEN(sizeof(int));
-
-        // Prepare the control message to send the file descriptor
-        struct cmsghdr *cmsg = (struct cmsghdr *) cmsg_ptr;
-        cmsg->cmsg_len = cmsg_size;
-        cmsg->cmsg_level = SOL_SOCKET;
-        cmsg->cmsg_type = SCM_RIGHTS;
-        memcpy(CMSG_DATA(cmsg), &file_fd, sizeof(int));
-
-        // Move the pointer to the next position
-        cmsg_ptr += CMSG_SPACE(sizeof(int));
-    }
-#elif ONE_CMSGHDR == 1
-    // Prepare the control message to send the file descriptor
-    struct cmsghdr *cmsg = (struct cmsghdr *)cmsg_ptr;
-
-    // Calculate the size of the current control message
-    size_t cmsg_size = CMSG_LEN(sizeof(int) * file_count);
-
-    *cmsg = (struct cmsghdr) { .cmsg_len = cmsg_size, .cmsg_level = SOL_SOCKET, .cmsg_type = SCM_RIGHTS };
-
-    memcpy(CMSG_DATA(cmsg), file_fds, sizeof(int) * file_count);
-#endif
-
-    // Set the control message buffer and length in the message header
-    message.msg_control = cmsgbuf;
-    message.msg_controllen = cmsg_total_size;
-
-    // Send the message with the file descriptors
-    size_t send_size = sendmsg(socket_file_descriptor, &message, 0);
+    // Send the messages with the file descriptors
+    ssize_t send_size = send_descriptors(socket_file_descriptor, &message, file_fds, file_count);
     if (send_size == -1) {
-        perror("\n\nsendmsg");
         return 1;
     }
-    printf("\n\nSend size: %lu\n", send_size);
+    printf("\n\nSend size: %zd\n", send_size);
 
     // Close file descriptors and socket
-    for (int i = 0; i < file_count; i++) {
+    for (size_t i = 0; i < file_count; i++) {
         close(file_fds[i]);
     }
     close(socket_file_descriptor);
 
     // Clean memory
-    free(cmsgbuf);
     free(file_fds);
     free(iov_base_buff);
     free(iov_base_buff_s);
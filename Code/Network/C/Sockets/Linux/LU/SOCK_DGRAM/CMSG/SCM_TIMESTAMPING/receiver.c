@@ -23,8 +23,9 @@
 #include <linux/errqueue.h>
 #include <linux/net_tstamp.h>
 
+#include "time_format.h"
+
 #define F_UNIX 0
-#define TIME_SIZE 20
 #define BUFF_SIZE 65535
 #define SOCKET_PATH "/tmp/RECEIVER"
 
@@ -34,28 +35,15 @@ void debug_sock_unix(const socklen_t* address_size, const struct sockaddr_un* ad
     printf("Sender family (%s): %hu\n\n", from, address->sun_family);
 }
 
-int decode_timespec(const struct timespec* timestamp) {
-    // Convert time_t to the broken-down time (struct tm)
-    struct tm *time_info = localtime(&timestamp->tv_sec);
-
-    // Print the time in the desired format
-    char *time_str = calloc((size_t) TIME_SIZE, sizeof(char));
-    if (time_str == NULL) {
-        perror("\n\ncalloc");
-        return -1;
-    }
-
-    strftime(time_str, (size_t) TIME_SIZE, "%Y-%m-%d %H:%M:%S", time_info);
-    printf("Timestamp (strftime - timespec): %s\n", time_str);
+// Local time of last second, shared by every decode of receiver
+struct time_format time_format = {0};
 
-    // Print the time in the manual format
-    printf("Timestamp (manually - timespec): %02d-%02d-%04d %02d:%02d:%02d.%06ld\n\n",
-           time_info->tm_mday, time_info->tm_mon + 1, time_info->tm_year + 1900,
-           time_info->tm_hour, time_info->tm_min, time_info->tm_sec, timestamp->tv_nsec);
+int decode_timespec(const struct timespec* timestamp) {
+    // Declaration and assign buffer of time, formatter renders date only when second changes
+    char time_str[TIME_FORMAT_SIZE] = {0};
 
-    // Clean memory
-    free(time_info);
-    free(time_str);
+    time_format_timespec(&time_format, timestamp, time_str, sizeof(time_str));
+    printf("Timestamp (time_format - timespec): %s\n\n", time_str);
 
     return 0;
 }
@@ -97,6 +85,9 @@ int process_cmsg(struct cmsghdr* cmsg) {
 }
 
 int main() {
+    // Zone is read once, not on every stamp
+    time_format_init(&time_format);
+
     // Remove socket
     unlink(SOCKET_PATH);
 
@@ -0,0 +1,417 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <poll.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/inotify.h>
+
+#define F_UNIX 0
+// Count of entries in descriptor cache, power of two
+#define CACHE_SIZE 1024
+// Count of clients served at the same time
+#define MAX_CLIENTS 256
+// Count of attempts to open and watch file that is being replaced
+#define OPEN_RETRIES 3
+// Directory of served files, requests are names relative to it
+#define FP "../Test Files/"
+#define SOCKET_PATH "/tmp/RECEIVER"
+
+// Reply to request, descriptor travels with it when error is 0
+struct broker_reply {
+    int32_t error;
+    uint32_t cached;
+};
+
+// Entry of descriptor cache, path NULL - empty
+struct cache_entry {
+    char *path;
+    int fd;
+    int watch;
+};
+
+// Set by signal handler to stop broker
+volatile sig_atomic_t running = 1;
+
+void stop(int signal_number) {
+    (void) signal_number;
+    running = 0;
+}
+
+uint32_t hash_path(const char* path) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (; *path != '\0'; path++) {
+        hash = (hash ^ (uint8_t) *path) * 16777619u;
+    }
+    return hash;
+}
+
+// Returns entry of path or empty entry where path belongs, NULL if cache is full
+struct cache_entry* find_entry(struct cache_entry* cache, const char* path) {
+    uint32_t index = hash_path(path) & (CACHE_SIZE - 1);
+
+    for (int probe = 0; probe < CACHE_SIZE; probe++, index = (index + 1) & (CACHE_SIZE - 1)) {
+        if (cache[index].path == NULL || strcmp(cache[index].path, path) == 0) {
+            return &cache[index];
+        }
+    }
+
+    return NULL;
+}
+
+// Remove entry, following entries of the same probe run are moved back to keep them reachable
+void remove_entry(struct cache_entry* cache, struct cache_entry* entry) {
+    uint32_t hole = (uint32_t) (entry - cache);
+
+    close(entry->fd);
+    free(entry->path);
+    entry->path = NULL;
+
+    for (uint32_t index = (hole + 1) & (CACHE_SIZE - 1); cache[index].path != NULL;
+         index = (index + 1) & (CACHE_SIZE - 1)) {
+        uint32_t home = hash_path(cache[index].path) & (CACHE_SIZE - 1);
+
+        // Entry can move to hole only if hole lies between its home and its slot
+        if (((index - home) & (CACHE_SIZE - 1)) >= ((index - hole) & (CACHE_SIZE - 1))) {
+            cache[hole] = cache[index];
+            cache[index].path = NULL;
+            hole = index;
+        }
+    }
+}
+
+// Accept only names inside served directory
+int valid_name(const char* name) {
+    if (name[0] == '\0' || name[0] == '/') {
+        return 0;
+    }
+    for (const char *part = name; part != NULL; part = strchr(part, '/')) {
+        if (*part == '/') {
+            part++;
+        }
+        if (strncmp(part, "..", 2) == 0 && (part[2] == '/' || part[2] == '\0')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Returns descriptor of file with watch on the same inode, -1 with errno on error
+int open_watched(int directory_file_descriptor, int inotify_file_descriptor, const char* name, int* watch) {
+    char *file_path = calloc(strlen(FP) + strlen(name) + 1, sizeof(char));
+    if (file_path == NULL) {
+        return -1;
+    }
+    strcpy(file_path, FP); strcat(file_path, name);
+
+    for (int attempt = 0; attempt < OPEN_RETRIES; attempt++) {
+        int fd = openat(directory_file_descriptor, name, O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            break;
+        }
+
+        *watch = inotify_add_watch(inotify_file_descriptor, file_path,
+                                   IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVE_SELF | IN_DELETE_SELF);
+        if (*watch == -1) {
+            int error = errno;
+            close(fd);
+            errno = error;
+            break;
+        }
+
+        // Watch follows path, file replaced after open leaves descriptor without invalidation
+        struct stat opened = {0}, watched = {0};
+        if (fstat(fd, &opened) == 0 && stat(file_path, &watched) == 0
+            && opened.st_dev == watched.st_dev && opened.st_ino == watched.st_ino) {
+            free(file_path);
+            return fd;
+        }
+
+        close(fd);
+        errno = ESTALE;
+    }
+
+    int error = errno;
+    free(file_path);
+    errno = error;
+
+    return -1;
+}
+
+int send_reply(int client_file_descriptor, const struct broker_reply* reply, int fd) {
+    // Declaration and assign input/output vector
+    struct iovec iov = { .iov_base = (void *) reply, .iov_len = sizeof(*reply) };
+    // Declaration and assign message header
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    // Set control buffer, aligned for cmsghdr
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control = {0};
+
+    if (fd != -1) {
+        message.msg_control = control.buffer;
+        message.msg_controllen = sizeof(control.buffer);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    // Client that does not read replies is dropped, it must not stall other clients
+    if (sendmsg(client_file_descriptor, &message, MSG_NOSIGNAL | MSG_DONTWAIT) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int main() {
+    // Remove socket
+    unlink(SOCKET_PATH);
+
+    // Set descriptor cache
+    struct cache_entry *cache = calloc(CACHE_SIZE, sizeof(struct cache_entry));
+    // Set poll vector, listening socket, inotify, clients
+    struct pollfd *poll_descriptors = calloc(MAX_CLIENTS + 2, sizeof(struct pollfd));
+    // Set buffer for request and for inotify events
+    char *request = calloc(PATH_MAX + 1, sizeof(char));
+    char *events = calloc(4096, sizeof(char));
+    if (cache == NULL || poll_descriptors == NULL || request == NULL || events == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+    // Declaration and assign served directory and inotify descriptors
+    int directory_file_descriptor = -1, inotify_file_descriptor = -1;
+    // Declaration and assign count of watched descriptors
+    nfds_t count = 2;
+
+    // Declaration and assign statistics
+    uint64_t requests = 0, hits = 0, misses = 0, failures = 0, invalidations = 0;
+
+    // Declaration and assign socket address unix
+    struct sockaddr_un socket_address = {0};
+    // Declaration and assign signal action
+    struct sigaction action = {0};
+
+    // Clean buffer
+    memset(&socket_address, 0, sizeof(socket_address));
+    memset(&action, 0, sizeof(action));
+
+    // Open served directory, files are opened relative to it
+    directory_file_descriptor = open(FP, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory_file_descriptor == -1) {
+        perror("\n\nopen");
+        return 1;
+    }
+
+    // Create inotify instance, changed file invalidates its entry
+    inotify_file_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_file_descriptor == -1) {
+        perror("\n\ninotify_init1");
+        return 1;
+    }
+
+    // Create socket
+    socket_file_descriptor = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, F_UNIX);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    // Set socket socket address
+    socket_address.sun_family = PF_UNIX;
+    strcpy(socket_address.sun_path, SOCKET_PATH);
+
+    // Bind socket to socket address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    // Listen input connections
+    if (listen(socket_file_descriptor, SOMAXCONN) == -1) {
+        perror("\n\nlisten");
+        return 1;
+    }
+
+    poll_descriptors[0] = (struct pollfd) { .fd = socket_file_descriptor, .events = POLLIN };
+    poll_descriptors[1] = (struct pollfd) { .fd = inotify_file_descriptor, .events = POLLIN };
+
+    // Stop broker on SIGINT and SIGTERM
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    printf("Serving: %s, on: %s\n", FP, SOCKET_PATH);
+    fflush(stdout);
+
+    while (running) {
+        // Table is full, stop watching listener until client closes, pending connections wait in queue
+        poll_descriptors[0].events = count < MAX_CLIENTS + 2 ? POLLIN : 0;
+
+        if (poll(poll_descriptors, count, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("\n\npoll");
+            return 1;
+        }
+
+        // Invalidate entries of changed files, hard links share one watch
+        if (poll_descriptors[1].revents != 0) {
+            ssize_t length = 0;
+            while ((length = read(inotify_file_descriptor, events, 4096)) > 0) {
+                for (char *pointer = events; pointer < events + length;) {
+                    const struct inotify_event *event = (const struct inotify_event *) pointer;
+
+                    // Removal moves entries back, scan again until nothing is removed
+                    for (int removed = 1; removed;) {
+                        removed = 0;
+                        for (int i = 0; i < CACHE_SIZE; i++) {
+                            if (cache[i].path != NULL && cache[i].watch == event->wd) {
+                                remove_entry(cache, &cache[i]);
+                                ++invalidations; removed = 1;
+                            }
+                        }
+                    }
+                    if (!(event->mask & IN_IGNORED)) {
+                        inotify_rm_watch(inotify_file_descriptor, event->wd);
+                    }
+
+                    pointer += sizeof(struct inotify_event) + event->len;
+                }
+            }
+        }
+
+        // Serve requests, closed client is replaced by last entry
+        for (nfds_t i = 2; i < count;) {
+            if (poll_descriptors[i].revents == 0) {
+                i++;
+                continue;
+            }
+
+            ssize_t received = recv(poll_descriptors[i].fd, request, PATH_MAX, MSG_DONTWAIT);
+            if (received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+                i++;
+                continue;
+            }
+            if (received <= 0) {
+                close(poll_descriptors[i].fd);
+                poll_descriptors[i] = poll_descriptors[--count];
+                continue;
+            }
+            request[received] = '\0';
+            ++requests;
+
+            // Declaration and assign reply
+            struct broker_reply reply = {0};
+            struct cache_entry *entry = valid_name(request) ? find_entry(cache, request) : NULL;
+
+            if (entry != NULL && entry->path != NULL) {
+                reply.cached = 1; ++hits;
+            } else if (entry != NULL) {
+                // Miss, open file once, then every request is served from cache
+                int watch = -1;
+                int fd = open_watched(directory_file_descriptor, inotify_file_descriptor, request, &watch);
+
+                if (fd == -1) {
+                    reply.error = errno;
+                } else {
+                    *entry = (struct cache_entry) { .path = strdup(request), .fd = fd, .watch = watch };
+                    if (entry->path == NULL) {
+                        perror("\n\nstrdup");
+                        return 1;
+                    }
+                }
+                ++misses;
+            } else {
+                reply.error = valid_name(request) ? ENOSPC : EACCES;
+            }
+
+            if (reply.error != 0) {
+                ++failures;
+            }
+
+            if (send_reply(poll_descriptors[i].fd, &reply, reply.error == 0 ? entry->fd : -1) == -1) {
+                close(poll_descriptors[i].fd);
+                poll_descriptors[i] = poll_descriptors[--count];
+                continue;
+            }
+            i++;
+        }
+
+        // Accept new clients
+        if (poll_descriptors[0].revents != 0 && count < MAX_CLIENTS + 2) {
+            int client_file_descriptor = accept4(socket_file_descriptor, NULL, NULL, SOCK_CLOEXEC);
+            if (client_file_descriptor == -1) {
+                if (errno != EINTR && errno != ECONNABORTED) {
+                    perror("\n\naccept4");
+                }
+            } else {
+                poll_descriptors[count++] = (struct pollfd) { .fd = client_file_descriptor, .events = POLLIN };
+            }
+        }
+    }
+
+    printf("Requests: %lu, hits: %lu, misses: %lu, failures: %lu, invalidations: %lu\n",
+           (unsigned long) requests, (unsigned long) hits, (unsigned long) misses,
+           (unsigned long) failures, (unsigned long) invalidations);
+
+    // Close cached descriptors
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        if (cache[i].path != NULL) {
+            close(cache[i].fd);
+            free(cache[i].path);
+        }
+    }
+
+    // Close sockets
+    for (nfds_t i = 2; i < count; i++) {
+        close(poll_descriptors[i].fd);
+    }
+    close(socket_file_descriptor);
+    close(inotify_file_descriptor);
+    close(directory_file_descriptor);
+
+    // Clean memory
+    free(events);
+    free(request);
+    free(poll_descriptors);
+    free(cache);
+
+    // Remove socket
+    unlink(SOCKET_PATH);
+
+    return 0;
+}
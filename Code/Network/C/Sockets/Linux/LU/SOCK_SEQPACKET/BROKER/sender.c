@@ -0,0 +1,199 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+
+#define F_UNIX 0
+#define BUFF_SIZE 65535
+// Count of requests of every file
+#define ROUNDS 10000
+#define FP "../Test Files/"
+#define TARGET_SOCKET_PATH "/tmp/RECEIVER"
+
+// Reply to request, descriptor travels with it when error is 0
+struct broker_reply {
+    int32_t error;
+    uint32_t cached;
+};
+
+uint64_t now_ns() {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+// Request descriptor of file from broker, returns descriptor or -1
+int request_descriptor(int socket_file_descriptor, const char* filename, struct broker_reply* reply) {
+    // Declaration and assign input/output vector
+    struct iovec iov = { .iov_base = reply, .iov_len = sizeof(*reply) };
+    // Declaration and assign message header
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    // Set control buffer, aligned for cmsghdr
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control = {0};
+
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    // Request is name of file, message boundary ends it
+    if (send(socket_file_descriptor, filename, strlen(filename), 0) == -1) {
+        perror("\n\nsend");
+        return -1;
+    }
+
+    if (recvmsg(socket_file_descriptor, &message, MSG_CMSG_CLOEXEC) != sizeof(*reply)) {
+        perror("\n\nrecvmsg");
+        return -1;
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    if (reply->error != 0 || cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        return -1;
+    }
+
+    int fd = -1;
+    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+    return fd;
+}
+
+int main() {
+    // Set buffer for read data
+    char *data = calloc((size_t) BUFF_SIZE, sizeof(char));
+    if (data == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+
+    // Declaration and assign statistics
+    uint64_t broker_ns = 0, open_ns = 0, cached = 0;
+
+    // Declaration and assign target socket address unix
+    struct sockaddr_un target_socket_address = {0};
+
+    // Clean buffer
+    memset(&target_socket_address, 0, sizeof(target_socket_address));
+
+    // Filenames
+    char *filenames[] = {
+            "file.txt",
+            "file1.txt",
+            "file2.txt",
+            "file3.txt",
+            NULL
+    };
+
+    // Create socket
+    socket_file_descriptor = socket(AF_UNIX, SOCK_SEQPACKET, F_UNIX);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    // Set target socket address
+    target_socket_address.sun_family = PF_UNIX;
+    strcpy(target_socket_address.sun_path, TARGET_SOCKET_PATH);
+
+    // Connect to socket
+    if (connect(
+            socket_file_descriptor, (struct sockaddr *) &target_socket_address, sizeof(target_socket_address)
+    ) == -1) {
+        perror("\n\nconnect");
+        return 1;
+    }
+
+    for (int round = 0; round < ROUNDS; round++) {
+        for (int i = 0; filenames[i] != NULL; i++) {
+            // Declaration and assign reply
+            struct broker_reply reply = {0};
+
+            uint64_t start_ns = now_ns();
+
+            int fd = request_descriptor(socket_file_descriptor, filenames[i], &reply);
+            if (fd == -1) {
+                fprintf(stderr, "\n\nrequest %s: %s\n", filenames[i], strerror(reply.error));
+                return 1;
+            }
+
+            // Descriptor shares file offset with broker and other clients, read with pread
+            ssize_t length = pread(fd, data, (size_t) BUFF_SIZE - 1, 0);
+            if (length == -1) {
+                perror("\n\npread");
+                return 1;
+            }
+            close(fd);
+
+            broker_ns += now_ns() - start_ns; cached += reply.cached;
+
+            if (round == 0) {
+                data[length] = '\0';
+                printf("Read data (%s, %s): %s\n", filenames[i], reply.cached ? "cached" : "opened", data);
+            }
+
+            // Same work with path lookup and permission check on every open
+            start_ns = now_ns();
+
+            char *file_path = calloc(strlen(FP) + strlen(filenames[i]) + 1, sizeof(char));
+            if (file_path == NULL) {
+                perror("\n\ncalloc");
+                return 1;
+            }
+            strcpy(file_path, FP); strcat(file_path, filenames[i]);
+
+            fd = open(file_path, O_RDONLY | O_CLOEXEC);
+            if (fd == -1) {
+                perror("\n\nopen");
+                return 1;
+            }
+            if (pread(fd, data, (size_t) BUFF_SIZE - 1, 0) == -1) {
+                perror("\n\npread");
+                return 1;
+            }
+            close(fd);
+            free(file_path);
+
+            open_ns += now_ns() - start_ns;
+        }
+    }
+
+    uint64_t total = (uint64_t) ROUNDS * 4;
+
+    printf("Requests: %lu, served from cache: %lu\n", (unsigned long) total, (unsigned long) cached);
+    printf("Broker request + pread avg: %.0f ns\n", (double) broker_ns / (double) total);
+    printf("open + pread avg: %.0f ns\n", (double) open_ns / (double) total);
+
+    // Close socket
+    close(socket_file_descriptor);
+
+    // Clean memory
+    free(data);
+
+    return 0;
+}
@@ -13,73 +13,555 @@
  * limitations under the License.
  */
 
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include <string.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdatomic.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <sys/sendfile.h>
+#include <sys/resource.h>
+
+#include "uring.h"
 
 #define F_UNIX 0
 #define BUFF_SIZE 65535
+// Reads in kernel at once and size of first read of file with unknown size
+#define QUEUE_DEPTH 256
+#define READ_CHUNK 65536
+#define READ_THREADS 8
+// Downstream of relay mode and size of one splice through pipe
+#define RELAY_PORT 54321
+#define RELAY_CHUNK 65536
 #define SOCKET_PATH "/tmp/RECEIVER"
 
+// What receiver does with contents of received files
+enum file_access {
+    ACCESS_READ,
+    // Map lazily, pages are faulted in and read ahead as callback walks file
+    ACCESS_MMAP,
+    // Map with every page faulted in before callback, pays for pages callback does not touch
+    ACCESS_MMAP_POPULATE,
+    ACCESS_RELAY
+};
+
+// Header of every message, descriptors are reassembled by offset, stream has no boundaries of messages
+struct descriptor_chunk {
+    uint32_t total;
+    uint32_t offset;
+    uint32_t count;
+    // Length of data after header
+    uint32_t length;
+};
+
 void debug_sock_unix(const socklen_t* address_size, const struct sockaddr_un* address, char* from) {
     printf("\nSender size (%s): %u\n", from, *address_size);
     printf("Sender unix socket path (%s): %s\n", from, address->sun_path);
     printf("Sender family (%s): %hu\n\n", from, address->sun_family);
 }
 
-int read_descriptors(int* cmsg_descriptors, size_t cmsg_count_descriptors) {
-    // Declaration and assign count of real file descriptors without align area
-    size_t count_descriptors = 0;
-    // Set buffer for read data
-    char *data = calloc((size_t) BUFF_SIZE, sizeof(char));
-    if (data == NULL) {
-        perror("\n\ncalloc");
-        exit(EXIT_FAILURE);
+// State of reading one received descriptor up to end of file
+struct descriptor_read {
+    int fd;
+    int error;
+    int seekable;
+    char *data;
+    size_t length;
+    size_t capacity;
+    // Target of pending io_uring read, must live until completion
+    struct iovec iov;
+};
+
+// Consumer of contents of received file, data is valid only during call
+typedef void (*descriptor_callback)(int fd, const char* data, size_t length, void* context);
+
+// Context shared by threads of preadv pool
+struct read_pool {
+    struct descriptor_read *files;
+    size_t count;
+    atomic_size_t next;
+};
+
+uint64_t now_ns() {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+int prepare_read(struct descriptor_read* file, int fd) {
+    // Declaration and assign status of file
+    struct stat status = {0};
+
+    file->fd = fd;
+    file->capacity = READ_CHUNK;
+
+    if (fstat(fd, &status) == -1) {
+        file->error = errno;
+        return -1;
     }
 
-    printf("Count of cmsg file descriptors: %lu\n", cmsg_count_descriptors);
+    // Regular file is read in one request with room to see end of file, others grow by chunks
+    file->seekable = S_ISREG(status.st_mode) || S_ISBLK(status.st_mode);
+    if (S_ISREG(status.st_mode) && status.st_size > 0) {
+        file->capacity = (size_t) status.st_size + 1;
+    }
 
-    for (int i = 0; i < cmsg_count_descriptors; i++) {
-        // Get file descriptor
-        const int *fd = &cmsg_descriptors[i];
+    file->data = malloc(file->capacity);
+    if (file->data == NULL) {
+        file->error = ENOMEM;
+        return -1;
+    }
 
-        // We check the file descriptor on NULL, because after alignment we can get a 0 descriptor.
-        if (*fd != 0) {
-            // Print file descriptor
-            printf("Received file descriptor: %d\n", cmsg_descriptors[i]);
+    return 0;
+}
+
+// Grow buffer when it is full, returns free space or 0 on failure
+size_t reserve_space(struct descriptor_read* file) {
+    if (file->length == file->capacity) {
+        char *data = realloc(file->data, file->capacity * 2);
+        if (data == NULL) {
+            file->error = ENOMEM;
+            return 0;
+        }
+        file->data = data;
+        file->capacity *= 2;
+    }
+
+    return file->capacity - file->length;
+}
+
+// Queue read of next part of file, index of file comes back in completion
+int queue_read(struct uring* ring, struct descriptor_read* file, size_t index, size_t space) {
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (sqe == NULL) {
+        return -1;
+    }
+
+    file->iov.iov_base = file->data + file->length;
+    // Single read is limited by kernel to 2 GiB anyway
+    file->iov.iov_len = space < (size_t) INT32_MAX ? space : (size_t) INT32_MAX;
+
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = file->fd;
+    sqe->addr = (uint64_t) (uintptr_t) &file->iov;
+    sqe->len = 1;
+    // Offset -1 reads from current position of pipes and sockets
+    sqe->off = file->seekable ? (uint64_t) file->length : (uint64_t) -1;
+    sqe->user_data = (uint64_t) index;
+
+    return 0;
+}
 
-            // Read from descriptor and save read data to buffer
-            if ((read(*fd, data, (size_t) BUFF_SIZE)) == -1) {
-                perror("\n\nread");
+int read_uring(struct uring* ring, struct descriptor_read* files, size_t count) {
+    // Declaration and assign completion, next file for first read and count of reads in kernel
+    struct io_uring_cqe cqe = {0};
+    size_t next = 0, in_flight = 0;
+    // Declaration and assign result, after failure nothing is queued but reads in kernel still fill buffers
+    int result = 0;
+
+    while ((result == 0 && next < count) || in_flight > 0) {
+        // Fill free submission entries with first reads of remaining files
+        for (; result == 0 && next < count && in_flight < ring->sq_entries; next++) {
+            if (files[next].error == 0) {
+                if (queue_read(ring, &files[next], next, files[next].capacity) == -1) {
+                    perror("\n\nio_uring_enter");
+                    result = -1;
+                    break;
+                }
+                ++in_flight;
+            }
+        }
+
+        if (in_flight == 0) {
+            break;
+        }
+
+        // Submit all queued reads and wait for at least one completion in one system call
+        if (uring_enter(ring, 1, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("\n\nio_uring_enter");
+            // Ring is unusable, reads in kernel can not be waited for
+            if (errno != EAGAIN && errno != EBUSY) {
                 return -1;
             }
+            // Out of resources or completion ring overflowed, reap what is there and wait again
+            result = -1;
+        }
+
+        while (uring_reap(ring, &cqe)) {
+            struct descriptor_read *file = &files[cqe.user_data];
+
+            --in_flight;
+
+            if (cqe.res < 0) {
+                file->error = -cqe.res;
+            } else if (cqe.res > 0) {
+                file->length += (size_t) cqe.res;
+
+                // Completion freed entry, read rest of file right away
+                size_t space = result == 0 ? reserve_space(file) : 0;
+                if (space > 0) {
+                    if (queue_read(ring, file, (size_t) cqe.user_data, space) == -1) {
+                        perror("\n\nio_uring_enter");
+                        file->error = errno;
+                        result = -1;
+                        continue;
+                    }
+                    ++in_flight;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+void read_file(struct descriptor_read* file) {
+    while (file->error == 0) {
+        size_t space = reserve_space(file);
+        if (space == 0) {
+            break;
+        }
+
+        struct iovec iov = { .iov_base = file->data + file->length, .iov_len = space };
+
+        ssize_t length = file->seekable ? preadv(file->fd, &iov, 1, (off_t) file->length)
+                                        : readv(file->fd, &iov, 1);
+        if (length == -1) {
+            if (errno != EINTR) {
+                file->error = errno;
+            }
+            continue;
+        }
+
+        if (length == 0) {
+            break;
+        }
 
-            // Print read data
-            printf("Read data: %s\n", data);
+        file->length += (size_t) length;
+    }
+}
+
+void* read_worker(void* argument) {
+    struct read_pool *pool = argument;
+
+    for (size_t i; (i = atomic_fetch_add(&pool->next, 1)) < pool->count;) {
+        if (pool->files[i].error == 0) {
+            read_file(&pool->files[i]);
+        }
+    }
+
+    return NULL;
+}
+
+// Fallback without io_uring, threads take files one by one
+void read_threads(struct descriptor_read* files, size_t count) {
+    // Declaration and assign pool of threads
+    pthread_t threads[READ_THREADS];
+    struct read_pool pool = { .files = files, .count = count };
+    size_t started = 0;
+
+    atomic_init(&pool.next, 0);
+
+    for (; started < READ_THREADS && started < count; started++) {
+        if (pthread_create(&threads[started], NULL, read_worker, &pool) != 0) {
+            break;
+        }
+    }
+
+    // Calling thread takes part too and finishes work when no thread started
+    read_worker(&pool);
+
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+void print_file(int fd, const char* data, size_t length, void* context) {
+    size_t *total_bytes = context;
+
+    // Print file descriptor
+    printf("Received file descriptor: %d\n", fd);
+
+    // Print read data, big files only by beginning
+    printf("Read data (%zu bytes): %.*s\n", length, (int) (length < BUFF_SIZE ? length : BUFF_SIZE), data);
+
+    *total_bytes += length;
+}
+
+// Map every file read-only and hand mapping to callback without copy to buffer
+int map_descriptors(const int* cmsg_descriptors, size_t cmsg_count_descriptors, int populate,
+                    descriptor_callback callback, void* context) {
+    // Declaration and assign result
+    int result = 0;
+
+    for (size_t i = 0; i < cmsg_count_descriptors; i++) {
+        // Declaration and assign status of file
+        struct stat status = {0};
 
-            // Clean buffer
-            memset(data, 0, (size_t) BUFF_SIZE);
+        const int fd = cmsg_descriptors[i];
 
-            // Close descriptor
-            close(cmsg_descriptors[i]);
+        if (fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+            size_t length = (size_t) status.st_size;
 
-            // Increase count of read descriptors
-            ++count_descriptors;
+            // Pages of file are shared with page cache and other receivers of the same file
+            char *data = mmap(NULL, length, PROT_READ, MAP_SHARED | (populate ? MAP_POPULATE : 0), fd, 0);
+            if (data == MAP_FAILED) {
+                fprintf(stderr, "mmap %d: %s\n", fd, strerror(errno));
+                result = -1;
+            } else {
+                // Lazy mapping reads ahead aggressively and drops pages behind, works without hint too,
+                // populated mapping has every page already
+                if (!populate && madvise(data, length, MADV_SEQUENTIAL) == -1) {
+                    fprintf(stderr, "madvise %d: %s\n", fd, strerror(errno));
+                }
+
+                callback(fd, data, length, context);
+
+                munmap(data, length);
+            }
         } else {
-            // Break from cycle
+            // Empty, special and procfs files can not be mapped, read them
+            struct descriptor_read file = {0};
+
+            if (prepare_read(&file, fd) == 0) {
+                read_file(&file);
+            }
+
+            if (file.error != 0) {
+                fprintf(stderr, "read %d: %s\n", fd, strerror(file.error));
+                result = -1;
+            } else {
+                callback(fd, file.data, file.length, context);
+            }
+
+            free(file.data);
+        }
+    }
+
+    return result;
+}
+
+int connect_downstream() {
+    // Declaration and assign downstream address
+    struct sockaddr_in downstream_address = {0};
+
+    int downstream = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (downstream == -1) {
+        perror("\n\nsocket");
+        return -1;
+    }
+
+    downstream_address.sin_family = PF_INET;
+    downstream_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    downstream_address.sin_port = htons(RELAY_PORT);
+
+    if (connect(downstream, (struct sockaddr *) &downstream_address, sizeof(downstream_address)) == -1) {
+        perror("\n\nconnect");
+        close(downstream);
+        return -1;
+    }
+
+    return downstream;
+}
+
+// Stream file to socket inside kernel, returns count of sent bytes or -1
+ssize_t relay_file(int fd, int downstream, const int* relay_pipe) {
+    // Declaration and assign status of file
+    struct stat status = {0};
+    // Declaration and assign count of sent bytes
+    size_t total = 0;
+
+    if (fstat(fd, &status) == -1) {
+        return -1;
+    }
+
+    // Regular file goes from page cache to socket, own offset leaves offset of descriptor shared with sender
+    if (S_ISREG(status.st_mode)) {
+        off_t offset = 0;
+
+        while (offset < status.st_size) {
+            ssize_t sent = sendfile(downstream, fd, &offset, (size_t) (status.st_size - offset));
+            if (sent == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            // File was truncated after fstat
+            if (sent == 0) {
+                break;
+            }
+        }
+
+        return (ssize_t) offset;
+    }
+
+    // Pipes, sockets and character devices go through pipe, pages are moved and not copied
+    for (;;) {
+        ssize_t length = splice(fd, NULL, relay_pipe[1], NULL, RELAY_CHUNK, SPLICE_F_MOVE);
+        if (length == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+
+        if (length == 0) {
             break;
         }
+
+        while (length > 0) {
+            ssize_t sent = splice(relay_pipe[0], NULL, downstream, NULL, (size_t) length, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (sent == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return -1;
+            }
+            length -= sent;
+            total += (size_t) sent;
+        }
+    }
+
+    return (ssize_t) total;
+}
+
+int relay_descriptors(const int* cmsg_descriptors, size_t cmsg_count_descriptors) {
+    // Declaration and assign result and total of sent bytes
+    int result = 0;
+    size_t total_bytes = 0;
+    // Declaration and assign pipe for splice
+    int relay_pipe[2] = {-1, -1};
+
+    printf("Count of cmsg file descriptors: %lu\n", cmsg_count_descriptors);
+
+    int downstream = connect_downstream();
+    if (downstream == -1) {
+        return -1;
+    }
+
+    if (pipe(relay_pipe) == -1) {
+        perror("\n\npipe");
+        close(downstream);
+        return -1;
+    }
+
+    uint64_t start_ns = now_ns();
+
+    for (size_t i = 0; i < cmsg_count_descriptors; i++) {
+        ssize_t sent = relay_file(cmsg_descriptors[i], downstream, relay_pipe);
+        if (sent == -1) {
+            fprintf(stderr, "relay %d: %s\n", cmsg_descriptors[i], strerror(errno));
+            result = -1;
+            break;
+        }
+
+        printf("Relayed file descriptor: %d, bytes: %zd\n", cmsg_descriptors[i], sent);
+        total_bytes += (size_t) sent;
+    }
+
+    printf("Relayed %zu bytes in %.3f ms\n", total_bytes, (double) (now_ns() - start_ns) / 1e6);
+
+    close(relay_pipe[0]);
+    close(relay_pipe[1]);
+    close(downstream);
+
+    return result;
+}
+
+int read_descriptors(const int* cmsg_descriptors, size_t cmsg_count_descriptors, enum file_access access,
+                     descriptor_callback callback, void* context) {
+    // Declaration and assign result and name of engine
+    int result = 0;
+    const char *engine = "io_uring";
+    // Declaration and assign instance of io_uring
+    struct uring ring = {0};
+
+    printf("Count of cmsg file descriptors: %lu\n", cmsg_count_descriptors);
+
+    if (access == ACCESS_MMAP || access == ACCESS_MMAP_POPULATE) {
+        uint64_t start_ns = now_ns();
+
+        result = map_descriptors(cmsg_descriptors, cmsg_count_descriptors, access == ACCESS_MMAP_POPULATE,
+                                 callback, context);
+
+        printf("Count of real file descriptors: %zu\n", cmsg_count_descriptors);
+        printf("Mapped files with mmap%s in %.3f ms\n",
+               access == ACCESS_MMAP_POPULATE ? " and MAP_POPULATE" : "", (double) (now_ns() - start_ns) / 1e6);
+
+        return result;
+    }
+
+    struct descriptor_read *files = calloc(cmsg_count_descriptors, sizeof(struct descriptor_read));
+    if (files == NULL) {
+        perror("\n\ncalloc");
+        return -1;
+    }
+
+    // Count of descriptors comes from cmsg_len exactly, descriptor 0 is valid
+    for (size_t i = 0; i < cmsg_count_descriptors; i++) {
+        prepare_read(&files[i], cmsg_descriptors[i]);
+    }
+
+    uint64_t start_ns = now_ns();
+
+    // Reads of all descriptors go to kernel at once, thread pool when io_uring is not available
+    if (uring_setup(&ring, QUEUE_DEPTH, 0) == 0) {
+        result = read_uring(&ring, files, cmsg_count_descriptors);
+        uring_close(&ring);
+    } else {
+        engine = "preadv";
+        read_threads(files, cmsg_count_descriptors);
+    }
+
+    uint64_t elapsed_ns = now_ns() - start_ns;
+
+    for (size_t i = 0; i < cmsg_count_descriptors; i++) {
+        if (files[i].error != 0) {
+            fprintf(stderr, "read %d: %s\n", files[i].fd, strerror(files[i].error));
+            result = -1;
+        } else {
+            callback(files[i].fd, files[i].data, files[i].length, context);
+        }
+
+        free(files[i].data);
     }
 
     // Print real count of file descriptors
-    printf("Count of real file descriptors: %zu\n", count_descriptors);
+    printf("Count of real file descriptors: %zu\n", cmsg_count_descriptors);
+    printf("Read files with %s in %.3f ms\n", engine, (double) elapsed_ns / 1e6);
 
     // Clean memory
-    free(data);
-    free(cmsg_descriptors);
+    free(files);
+
+    return result;
+}
+
+// Read exactly size bytes from stream, returns -1 on error or end of stream
+int read_exactly(int fd, char* buffer, size_t size) {
+    for (size_t done = 0; done < size;) {
+        ssize_t length = recv(fd, buffer + done, size - done, 0);
+        if (length == -1 && errno == EINTR) {
+            continue;
+        }
+        if (length <= 0) {
+            return -1;
+        }
+        done += (size_t) length;
+    }
 
     return 0;
 }
@@ -91,7 +573,27 @@ size_t get_count_descriptors(socklen_t cmsg_len) {
     return cmsg_data_length / sizeof(int);
 }
 
-int process_cmsg(struct cmsghdr* cmsg) {
+int raise_file_limit() {
+    // Declaration and assign limit of descriptors
+    struct rlimit limit = {0};
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\ngetrlimit");
+        return -1;
+    }
+
+    // Soft limit can be raised up to hard limit without privileges
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\nsetrlimit");
+        return -1;
+    }
+
+    return 0;
+}
+
+// Append descriptors of control message to descriptors received before
+int process_cmsg(struct cmsghdr* cmsg, int** descriptors, size_t* count) {
     if (cmsg != NULL) {
         if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
 
@@ -100,16 +602,18 @@ int process_cmsg(struct cmsghdr* cmsg) {
             // Declaration and assign count of file descriptors with align area
             size_t cmsg_count_descriptors = get_count_descriptors(cmsg->cmsg_len);
 
-            // Declaration and assign array of file descriptors
-            int *cmsg_descriptors = calloc(cmsg_count_descriptors, sizeof(int));
-            if (cmsg_descriptors == NULL) {
-                perror("\n\ncalloc");
+            // Realloc memory for array of file descriptors
+            int *new_descriptors = realloc(*descriptors, (*count + cmsg_count_descriptors) * sizeof(int));
+            if (new_descriptors == NULL) {
+                perror("\n\nrealloc");
                 exit(EXIT_FAILURE);
             }
+            *descriptors = new_descriptors;
 
-            memcpy(cmsg_descriptors, CMSG_DATA(cmsg), sizeof(int) * cmsg_count_descriptors);
+            memcpy(*descriptors + *count, CMSG_DATA(cmsg), sizeof(int) * cmsg_count_descriptors);
+            *count += cmsg_count_descriptors;
 
-            return read_descriptors(cmsg_descriptors, cmsg_count_descriptors);
+            return 0;
         }
         printf("Total current cmsg length: %lu\n", (size_t) cmsg->cmsg_len);
     }
@@ -117,7 +621,20 @@ int process_cmsg(struct cmsghdr* cmsg) {
     return 0;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Declaration and assign access to files, usage: receiver [read|mmap|populate|relay]
+    enum file_access access = ACCESS_READ;
+    if (argc > 1 && strcmp(argv[1], "mmap") == 0) {
+        access = ACCESS_MMAP;
+    } else if (argc > 1 && strcmp(argv[1], "populate") == 0) {
+        access = ACCESS_MMAP_POPULATE;
+    } else if (argc > 1 && strcmp(argv[1], "relay") == 0) {
+        access = ACCESS_RELAY;
+    } else if (argc > 1 && strcmp(argv[1], "read") != 0) {
+        fprintf(stderr, "Usage: %s [read|mmap|populate|relay]\n", argv[0]);
+        return 1;
+    }
+
     // Remove socket
     unlink(SOCKET_PATH);
 
@@ -186,38 +703,111 @@ int main() {
     // Get sender address info from accept
     debug_sock_unix(&sender_address_size, (struct sockaddr_un *) &sender_address, "accept");
 
-    // Init iovec
-    iov = (struct iovec) { .iov_base = iov_buffer, .iov_len = (size_t) BUFF_SIZE };
-
-    // Init msghdr
-    message = (struct msghdr) {
-            .msg_name = &sender_message_address, .msg_namelen = sender_message_address_size,
-            .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control_buffer, .msg_controllen = (size_t) BUFF_SIZE
-    };
-
-    // Receive message with file descriptor
-    ssize_t received = recvmsg(client_file_descriptor, &message, 0);
-    if (received == -1) {
-        perror("\n\nrecvmsg");
+    // Many descriptors can exceed default soft limit, kernel drops them with MSG_CTRUNC
+    if (raise_file_limit() == -1) {
         return 1;
     }
 
-    // Get sender address info from message
-    debug_sock_unix(&sender_message_address_size, (struct sockaddr_un *) &sender_message_address, "recvmsg");
+    // Declaration and assign header of message
+    struct descriptor_chunk chunk = {0};
+    // Declaration and assign input/output vector, only header is read with descriptors
+    struct iovec chunk_iov = {0};
+    // Declaration and assign received descriptors
+    int *descriptors = NULL;
+    size_t count_descriptors = 0;
+
+    // Receive messages until all descriptors of set are received
+    do {
+        // Init iovec
+        chunk_iov = (struct iovec) { .iov_base = &chunk, .iov_len = sizeof(chunk) };
+
+        // Init msghdr
+        message = (struct msghdr) {
+                .msg_name = &sender_message_address, .msg_namelen = sender_message_address_size,
+                .msg_iov = &chunk_iov, .msg_iovlen = 1,
+                .msg_control = control_buffer, .msg_controllen = (size_t) BUFF_SIZE
+        };
+
+        // Receive header with file descriptors, kernel attaches them to the first byte of header
+        ssize_t received = recvmsg(client_file_descriptor, &message, 0);
+        if (received == -1) {
+            perror("\n\nrecvmsg");
+            return 1;
+        }
+        if (received == 0) {
+            fprintf(stderr, "\n\nrecvmsg: end of stream before all descriptors\n");
+            return 1;
+        }
+
+        // Stream can return header in parts, rest of it carries no descriptors
+        if (read_exactly(client_file_descriptor, (char *) &chunk + received, sizeof(chunk) - (size_t) received) == -1) {
+            fprintf(stderr, "\n\nrecv: message without header\n");
+            return 1;
+        }
+
+        // Descriptors which did not fit control buffer or limit of descriptors are closed by kernel
+        if (message.msg_flags & MSG_CTRUNC) {
+            fprintf(stderr, "\n\nrecvmsg: MSG_CTRUNC, descriptors are lost\n");
+            return 1;
+        }
+
+        if (chunk.offset != count_descriptors) {
+            fprintf(stderr, "\n\nrecvmsg: descriptors %u..%u, expected from %zu\n",
+                    chunk.offset, chunk.offset + chunk.count, count_descriptors);
+            return 1;
+        }
+
+        // Data of message follows header, it is read apart so next header is not taken with it
+        if (chunk.length >= (uint32_t) BUFF_SIZE) {
+            fprintf(stderr, "\n\nrecv: data of %u bytes does not fit buffer\n", chunk.length);
+            return 1;
+        }
+        if (read_exactly(client_file_descriptor, iov_buffer, chunk.length) == -1) {
+            fprintf(stderr, "\n\nrecv: message without data\n");
+            return 1;
+        }
+        iov_buffer[chunk.length] = '\0';
+        iov = (struct iovec) { .iov_base = iov_buffer, .iov_len = chunk.length };
 
-    printf("iov_base: %s\n", iov_buffer);
-    printf("iov_base_len: %lu\n", iov.iov_len);
-    printf("Current iov length: %i\n\n", message.msg_iovlen);
+        // Data of message travels with the first one
+        if (chunk.offset == 0) {
+            // Get sender address info from message
+            debug_sock_unix(&sender_message_address_size, (struct sockaddr_un *) &sender_message_address, "recvmsg");
 
-    // Handle received ancillary data
-    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+            printf("iov_base: %s\n", iov_buffer);
+            printf("iov_base_len: %lu\n", iov.iov_len);
+            printf("Current iov length: %zu\n\n", (size_t) message.msg_iovlen);
+        }
 
-    while (cmsg != NULL) {
-        if (process_cmsg(cmsg) == -1) {
-            fprintf(stderr, "Error message: Something went wrong with process cmsg!\n");
-            exit(1);
+        // Handle received ancillary data
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+            process_cmsg(cmsg, &descriptors, &count_descriptors);
         }
-        cmsg = CMSG_NXTHDR(&message, cmsg);
+
+        printf("Received descriptors: %u..%zu of %u\n", chunk.offset, count_descriptors, chunk.total);
+    } while (count_descriptors < chunk.total);
+
+    // Declaration and assign total of bytes passed to callback
+    size_t total_bytes = 0;
+
+    // Forward contents of files to downstream without copy to user space, or read or map them
+    int result = access == ACCESS_RELAY
+                 ? relay_descriptors(descriptors, count_descriptors)
+                 : read_descriptors(descriptors, count_descriptors, access, print_file, &total_bytes);
+
+    // Descriptors of set belong to main, they are closed after any result
+    for (size_t i = 0; i < count_descriptors; i++) {
+        close(descriptors[i]);
+    }
+    free(descriptors);
+
+    if (result == -1) {
+        fprintf(stderr, "Error message: Something went wrong with %s!\n",
+                access == ACCESS_RELAY ? "relay" : "process cmsg");
+        return 1;
+    }
+    if (access != ACCESS_RELAY) {
+        printf("Total bytes of files: %zu\n", total_bytes);
     }
 
     // Close socket
@@ -225,7 +815,6 @@ int main() {
     close(socket_file_descriptor);
 
     // Clean memory
-    free(cmsg);
     free(iov_buffer);
     free(control_buffer);
 
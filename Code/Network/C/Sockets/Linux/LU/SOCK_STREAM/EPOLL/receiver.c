@@ -0,0 +1,325 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#define F_UNIX 0
+// Size of read buffer shared by all connections
+#define BUFF_SIZE 65535
+// Size of connection table, indexed by descriptor
+#define MAX_CONNECTIONS 65536
+// Count of events taken by one epoll_wait call
+#define MAX_EVENTS 256
+// Exit after this count of closed connections, 0 - run until SIGINT/SIGTERM
+#define EXIT_AFTER_CONNECTIONS 0
+#define SOCKET_PATH "/tmp/RECEIVER"
+
+// Read state of one connection, no per-connection buffer
+struct connection {
+    uint64_t bytes;
+    uint32_t reads;
+    uint8_t open;
+};
+
+// Set by signal handler to stop event loop
+volatile sig_atomic_t running = 1;
+
+void stop(int signal_number) {
+    (void) signal_number;
+    running = 0;
+}
+
+int raise_file_limit() {
+    // Declaration and assign limit of descriptors
+    struct rlimit limit = {0};
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\ngetrlimit");
+        return -1;
+    }
+
+    // Soft limit can be raised up to hard limit without privileges
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\nsetrlimit");
+        return -1;
+    }
+
+    return 0;
+}
+
+int main() {
+    // Remove socket
+    unlink(SOCKET_PATH);
+
+    // Set buffer for data receive
+    char *buffer = calloc((size_t) BUFF_SIZE, sizeof(char));
+    // Set connection table
+    struct connection *connections = calloc(MAX_CONNECTIONS, sizeof(struct connection));
+    // Set vector of ready events
+    struct epoll_event *events = calloc(MAX_EVENTS, sizeof(struct epoll_event));
+    if (buffer == NULL || connections == NULL || events == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+    // Declaration and assign epoll descriptor
+    int epoll_file_descriptor = -1;
+    // Declaration and assign descriptor reserved for accept on EMFILE
+    int spare_file_descriptor = -1;
+    // Declaration and assign state of listener, paused while no descriptor is free
+    int accepting = 1;
+
+    // Declaration and assign statistics
+    size_t accepted = 0, closed = 0, active = 0, peak = 0, rejected = 0;
+    uint64_t bytes = 0, reads = 0;
+
+    // Declaration and assign socket address unix
+    struct sockaddr_un socket_address = {0};
+    // Declaration and assign signal action
+    struct sigaction action = {0};
+
+    // Clean buffer
+    memset(&socket_address, 0, sizeof(socket_address));
+    memset(&action, 0, sizeof(action));
+
+    // Stop event loop on SIGINT and SIGTERM
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    if (raise_file_limit() == -1) {
+        return 1;
+    }
+
+    // Reserve descriptor, drop pending connection even without free descriptors
+    spare_file_descriptor = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (spare_file_descriptor == -1) {
+        perror("\n\nopen");
+        return 1;
+    }
+
+    // Create non-blocking socket
+    socket_file_descriptor = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, F_UNIX);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    // Set socket socket address
+    socket_address.sun_family = PF_UNIX;
+    strcpy(socket_address.sun_path, SOCKET_PATH);
+
+    // Bind socket to socket address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    // Listen input connections
+    if (listen(socket_file_descriptor, SOMAXCONN) == -1) {
+        perror("\n\nlisten");
+        return 1;
+    }
+
+    // Create epoll instance
+    epoll_file_descriptor = epoll_create1(0);
+    if (epoll_file_descriptor == -1) {
+        perror("\n\nepoll_create1");
+        return 1;
+    }
+
+    // Watch listening socket, level-triggered, backlog left after EMFILE is reported again
+    struct epoll_event listen_event = { .events = EPOLLIN, .data.fd = socket_file_descriptor };
+    if (epoll_ctl(epoll_file_descriptor, EPOLL_CTL_ADD, socket_file_descriptor, &listen_event) == -1) {
+        perror("\n\nepoll_ctl");
+        return 1;
+    }
+
+    printf("Listening on: %s\n", SOCKET_PATH);
+
+    while (running) {
+        int ready = epoll_wait(epoll_file_descriptor, events, MAX_EVENTS, -1);
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("\n\nepoll_wait");
+            return 1;
+        }
+
+        for (int i = 0; i < ready; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == socket_file_descriptor) {
+                // Accept every pending connection
+                while (1) {
+                    int client_file_descriptor = accept4(socket_file_descriptor, NULL, NULL, SOCK_NONBLOCK);
+                    if (client_file_descriptor == -1) {
+                        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                            break;
+                        }
+                        if ((errno == EMFILE || errno == ENFILE) && spare_file_descriptor != -1) {
+                            // Free reserved descriptor, accept and drop connection, reserve again
+                            close(spare_file_descriptor);
+                            client_file_descriptor = accept(socket_file_descriptor, NULL, NULL);
+                            int accept_error = errno;
+                            if (client_file_descriptor != -1) {
+                                close(client_file_descriptor); ++rejected;
+                            }
+                            spare_file_descriptor = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                            if (client_file_descriptor != -1) {
+                                continue;
+                            }
+                            errno = accept_error;
+                            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                                break;
+                            }
+                        }
+                        if (errno == EMFILE || errno == ENFILE) {
+                            // No descriptor to drop connection, stop watching listener until one is closed
+                            listen_event.events = 0;
+                            if (epoll_ctl(epoll_file_descriptor, EPOLL_CTL_MOD, socket_file_descriptor, &listen_event) == -1) {
+                                perror("\n\nepoll_ctl");
+                                return 1;
+                            }
+                            accepting = 0;
+                            break;
+                        }
+                        perror("\n\naccept4");
+                        return 1;
+                    }
+
+                    if (client_file_descriptor >= MAX_CONNECTIONS) {
+                        close(client_file_descriptor); ++rejected;
+                        continue;
+                    }
+
+                    struct epoll_event client_event = {
+                            .events = EPOLLIN | EPOLLRDHUP | EPOLLET, .data.fd = client_file_descriptor
+                    };
+                    if (epoll_ctl(epoll_file_descriptor, EPOLL_CTL_ADD, client_file_descriptor, &client_event) == -1) {
+                        perror("\n\nepoll_ctl");
+                        return 1;
+                    }
+
+                    connections[client_file_descriptor] = (struct connection) { .open = 1 };
+
+                    ++accepted; ++active;
+                    if (active > peak) {
+                        peak = active;
+                    }
+                }
+                continue;
+            }
+
+            // Declaration and assign state of connection
+            struct connection *connection = &connections[fd];
+            int close_connection = 0;
+
+            // Edge-triggered, read until socket is empty, hang up still leaves queued data to read
+            while (connection->open) {
+                ssize_t received = recv(fd, buffer, (size_t) BUFF_SIZE, 0);
+                if (received == -1) {
+                    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                        perror("\n\nrecv");
+                        close_connection = 1;
+                    }
+                    break;
+                }
+                if (received == 0) {
+                    close_connection = 1;
+                    break;
+                }
+
+                connection->bytes += (uint64_t) received; ++connection->reads;
+            }
+
+            if (close_connection && connection->open) {
+                bytes += connection->bytes; reads += connection->reads;
+
+                // Closing descriptor removes it from epoll
+                connection->open = 0;
+                close(fd);
+
+                ++closed; --active;
+
+                // Descriptor is free again, reserve it and resume accept
+                if (!accepting) {
+                    if (spare_file_descriptor == -1) {
+                        spare_file_descriptor = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                    }
+                    listen_event.events = EPOLLIN;
+                    if (epoll_ctl(epoll_file_descriptor, EPOLL_CTL_MOD, socket_file_descriptor, &listen_event) == -1) {
+                        perror("\n\nepoll_ctl");
+                        return 1;
+                    }
+                    accepting = 1;
+                }
+
+#if EXIT_AFTER_CONNECTIONS != 0
+                if (closed == EXIT_AFTER_CONNECTIONS) {
+                    running = 0;
+                }
+#endif
+            }
+        }
+    }
+
+    // Account connections still open
+    for (int fd = 0; fd < MAX_CONNECTIONS; fd++) {
+        if (connections[fd].open) {
+            bytes += connections[fd].bytes; reads += connections[fd].reads;
+            close(fd);
+        }
+    }
+
+    printf("Accepted connections: %zu\n", accepted);
+    printf("Closed connections: %zu\n", closed);
+    printf("Rejected connections: %zu\n", rejected);
+    printf("Peak concurrent connections: %zu\n", peak);
+    printf("Received bytes: %lu\n", (unsigned long) bytes);
+    printf("Reads: %lu\n", (unsigned long) reads);
+
+    // Close sockets
+    if (spare_file_descriptor != -1) {
+        close(spare_file_descriptor);
+    }
+    close(epoll_file_descriptor);
+    close(socket_file_descriptor);
+
+    // Clean memory
+    free(events);
+    free(connections);
+    free(buffer);
+
+    // Remove socket
+    unlink(SOCKET_PATH);
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+#define F_UNIX 0
+// Count of concurrent clients
+#define CLIENTS 1000
+// Count of messages sent by every client
+#define MESSAGES 16
+#define TARGET_SOCKET_PATH "/tmp/RECEIVER"
+
+int raise_file_limit() {
+    // Declaration and assign limit of descriptors
+    struct rlimit limit = {0};
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\ngetrlimit");
+        return -1;
+    }
+
+    // Soft limit can be raised up to hard limit without privileges
+    limit.rlim_cur = limit.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &limit) == -1) {
+        perror("\n\nsetrlimit");
+        return -1;
+    }
+
+    return 0;
+}
+
+int main() {
+    // Set descriptors of all clients
+    int *client_file_descriptors = calloc(CLIENTS, sizeof(int));
+    if (client_file_descriptors == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign count of sent bytes
+    size_t bytes = 0;
+
+    // Declaration and assign target socket address unix
+    struct sockaddr_un target_socket_address = {0};
+
+    // Clean buffer
+    memset(&target_socket_address, 0, sizeof(target_socket_address));
+
+    if (raise_file_limit() == -1) {
+        return 1;
+    }
+
+    // Set target socket address
+    target_socket_address.sun_family = PF_UNIX;
+    strcpy(target_socket_address.sun_path, TARGET_SOCKET_PATH);
+
+    // Open all connections, clients are not bound and stay alive at the same time
+    for (int i = 0; i < CLIENTS; i++) {
+        client_file_descriptors[i] = socket(AF_UNIX, SOCK_STREAM, F_UNIX);
+        if (client_file_descriptors[i] == -1) {
+            perror("\n\nsocket");
+            return 1;
+        }
+
+        if (connect(
+                client_file_descriptors[i], (struct sockaddr *) &target_socket_address, sizeof(target_socket_address)
+        ) == -1) {
+            perror("\n\nconnect");
+            return 1;
+        }
+    }
+
+    printf("Connected clients: %d\n", CLIENTS);
+
+    // Send data, every round touches every client
+    const char* message = "Hello, receiver!";
+    for (int round = 0; round < MESSAGES; round++) {
+        for (int i = 0; i < CLIENTS; i++) {
+            ssize_t bytes_sent = send(client_file_descriptors[i], message, strlen(message), 0);
+            if (bytes_sent == -1) {
+                perror("\n\nsend");
+                return 1;
+            }
+            bytes += (size_t) bytes_sent;
+        }
+    }
+
+    printf("Message sent: %s\n", message);
+    printf("Sent bytes: %zu\n", bytes);
+
+    // Close sockets
+    for (int i = 0; i < CLIENTS; i++) {
+        close(client_file_descriptors[i]);
+    }
+
+    // Clean memory
+    free(client_file_descriptors);
+
+    return 0;
+}
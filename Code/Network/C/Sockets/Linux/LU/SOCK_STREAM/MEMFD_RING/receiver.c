@@ -0,0 +1,332 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <poll.h>
+#include <time.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdalign.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+
+#define F_UNIX 0
+// Count of slots in ring, power of two
+#define RING_SLOTS 4096
+// Size of one message, timestamp and sequence included
+#define MESSAGE_SIZE 64
+// Count of messages to receive
+#define MESSAGES 1000000
+// Size of bootstrap message, fixed because messages of socket transport follow it on stream
+#define BOOTSTRAP_SIZE 16
+// Count of empty polls of ring before consumer sleeps on doorbell
+#define SPIN_COUNT 4096
+#define SOCKET_PATH "/tmp/RECEIVER"
+
+// Shared header of ring, every index on its own cache line
+struct ring_header {
+    // Next slot to write, written by producer
+    alignas(64) atomic_uint_least64_t head;
+    // Next slot to read, written by consumer
+    alignas(64) atomic_uint_least64_t tail;
+    // Consumer waits on eventfd, producer rings doorbell only then
+    alignas(64) atomic_int sleeping;
+};
+
+struct ring_message {
+    uint64_t sequence;
+    uint64_t sent_ns;
+    char payload[MESSAGE_SIZE - 2 * sizeof(uint64_t)];
+};
+
+// Latency statistics of received messages
+struct latency {
+    uint64_t total_ns, max_ns;
+    size_t out_of_order;
+};
+
+uint64_t now_ns() {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+void account(struct latency* latency, const struct ring_message* message, uint64_t expected, uint64_t received_ns) {
+    uint64_t latency_ns = received_ns - message->sent_ns;
+
+    latency->total_ns += latency_ns;
+    if (latency_ns > latency->max_ns) {
+        latency->max_ns = latency_ns;
+    }
+    if (message->sequence != expected) {
+        ++latency->out_of_order;
+    }
+}
+
+int main() {
+    // Remove socket
+    unlink(SOCKET_PATH);
+
+    // Set buffer for bootstrap message
+    char *bootstrap = calloc(BOOTSTRAP_SIZE, sizeof(char));
+    if (bootstrap == NULL) {
+        perror("\n\ncalloc");
+        return 1;
+    }
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+    // Declaration and assign client descriptor
+    int client_file_descriptor = -1;
+    // Declaration and assign ring memory and doorbell descriptors
+    int memory_file_descriptor = -1, doorbell_file_descriptor = -1;
+
+    // Declaration and assign statistics
+    size_t syscalls = 0, wakeups = 0;
+    uint64_t first_sent_ns = 0, last_received_ns = 0;
+
+    // Declaration and assign latency statistics
+    struct latency latency = {0};
+    // Declaration and assign input/output vector
+    struct iovec iov = {0};
+    // Declaration and assign message header
+    struct msghdr message = {0};
+    // Declaration and assign socket address unix
+    struct sockaddr_un socket_address = {0};
+
+    // Set control buffer, aligned for cmsghdr
+    union {
+        char buffer[CMSG_SPACE(sizeof(int) * 2)];
+        struct cmsghdr align;
+    } control = {0};
+
+    // Clean buffer
+    memset(&socket_address, 0, sizeof(socket_address));
+
+    // Create socket
+    socket_file_descriptor = socket(AF_UNIX, SOCK_STREAM, F_UNIX);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    // Set socket socket address
+    socket_address.sun_family = PF_UNIX;
+    strcpy(socket_address.sun_path, SOCKET_PATH);
+
+    // Bind socket to socket address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    // Listen input connections
+    if (listen(socket_file_descriptor, 1) == -1) {
+        perror("\n\nlisten");
+        return 1;
+    }
+
+    // Accept incoming connection
+    client_file_descriptor = accept(socket_file_descriptor, NULL, NULL);
+    if (client_file_descriptor == -1) {
+        perror("\n\naccept");
+        return 1;
+    }
+
+    // Init iovec
+    iov = (struct iovec) { .iov_base = bootstrap, .iov_len = BOOTSTRAP_SIZE };
+
+    // Init msghdr
+    message = (struct msghdr) {
+            .msg_iov = &iov, .msg_iovlen = 1, .msg_control = control.buffer, .msg_controllen = sizeof(control.buffer)
+    };
+
+    // Receive bootstrap, ring transport carries ring memory and doorbell
+    if (recvmsg(client_file_descriptor, &message, MSG_WAITALL) != BOOTSTRAP_SIZE) {
+        perror("\n\nrecvmsg");
+        return 1;
+    }
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg != NULL; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS
+            && cmsg->cmsg_len == CMSG_LEN(sizeof(int) * 2)) {
+            int descriptors[2] = {0};
+            memcpy(descriptors, CMSG_DATA(cmsg), sizeof(descriptors));
+            memory_file_descriptor = descriptors[0]; doorbell_file_descriptor = descriptors[1];
+        }
+    }
+
+    int ring = strcmp(bootstrap, "ring") == 0;
+    if (ring && (memory_file_descriptor == -1 || doorbell_file_descriptor == -1)) {
+        fprintf(stderr, "\n\nrecvmsg: no ring descriptors\n");
+        return 1;
+    }
+
+    printf("Transport: %s\n", ring ? "ring" : "socket");
+
+    if (!ring) {
+        // Declaration and assign message
+        struct ring_message ring_message = {0};
+
+        for (uint64_t i = 0; i < MESSAGES; i++) {
+            ssize_t received = recv(client_file_descriptor, &ring_message, sizeof(ring_message), MSG_WAITALL);
+            if (received != sizeof(ring_message)) {
+                perror("\n\nrecv");
+                return 1;
+            }
+            ++syscalls;
+
+            last_received_ns = now_ns();
+            if (i == 0) {
+                first_sent_ns = ring_message.sent_ns;
+            }
+            account(&latency, &ring_message, i, last_received_ns);
+        }
+    } else {
+        // Declaration and assign size of shared memory
+        struct stat memory_stat = {0};
+        if (fstat(memory_file_descriptor, &memory_stat) == -1) {
+            perror("\n\nfstat");
+            return 1;
+        }
+        size_t memory_size = (size_t) memory_stat.st_size;
+        if (memory_size < sizeof(struct ring_header) + (size_t) RING_SLOTS * sizeof(struct ring_message)) {
+            fprintf(stderr, "\n\nfstat: ring is too small\n");
+            return 1;
+        }
+
+        // Map ring
+        void *memory = mmap(NULL, memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, memory_file_descriptor, 0);
+        if (memory == MAP_FAILED) {
+            perror("\n\nmmap");
+            return 1;
+        }
+
+        struct ring_header *header = memory;
+        const struct ring_message *slots = (const struct ring_message *) (header + 1);
+
+        // Declaration and assign consumer copy of indexes
+        uint64_t head = 0, tail = 0;
+        // Declaration and assign flag of closed bootstrap socket, producer keeps it open until it ends
+        int producer_closed = 0;
+
+        for (unsigned spins = 0; tail < MESSAGES;) {
+            head = atomic_load_explicit(&header->head, memory_order_acquire);
+
+            if (head == tail) {
+                if (++spins < SPIN_COUNT) {
+                    continue;
+                }
+
+                // Announce sleep, then check ring again, pairs with fence of producer
+                atomic_store_explicit(&header->sleeping, 1, memory_order_relaxed);
+                atomic_thread_fence(memory_order_seq_cst);
+
+                if (atomic_load_explicit(&header->head, memory_order_relaxed) == tail) {
+                    // Ring is drained and nobody can publish more
+                    if (producer_closed) {
+                        fprintf(stderr, "\n\nring: producer exited after %lu of %d messages\n",
+                                (unsigned long) tail, MESSAGES);
+                        return 1;
+                    }
+
+                    // Sleep on doorbell, hang up of bootstrap socket means producer exited
+                    struct pollfd wait_descriptors[2] = {
+                            { .fd = doorbell_file_descriptor, .events = POLLIN },
+                            { .fd = client_file_descriptor, .events = POLLIN }
+                    };
+                    if (poll(wait_descriptors, 2, -1) == -1 && errno != EINTR) {
+                        perror("\n\npoll");
+                        return 1;
+                    }
+                    ++syscalls;
+
+                    if (wait_descriptors[0].revents & POLLIN) {
+                        uint64_t value = 0;
+                        if (read(doorbell_file_descriptor, &value, sizeof(value)) == -1) {
+                            perror("\n\nread");
+                            return 1;
+                        }
+                        ++syscalls; ++wakeups;
+                    }
+
+                    // Nothing is sent on socket after bootstrap, readable means end of stream
+                    if (wait_descriptors[1].revents != 0) {
+                        producer_closed = 1;
+                    }
+                }
+
+                atomic_store_explicit(&header->sleeping, 0, memory_order_relaxed);
+                spins = 0;
+                continue;
+            }
+
+            last_received_ns = now_ns();
+            if (tail == 0) {
+                first_sent_ns = slots[0].sent_ns;
+            }
+
+            // Consume every published slot, then release them at once
+            for (; tail != head; tail++) {
+                account(&latency, &slots[tail & (RING_SLOTS - 1)], tail, last_received_ns);
+            }
+            atomic_store_explicit(&header->tail, tail, memory_order_release);
+        }
+
+        munmap(memory, memory_size);
+    }
+
+    double seconds = (double) (last_received_ns - first_sent_ns) / 1e9;
+
+    printf("Received messages: %d\n", MESSAGES);
+    printf("Received bytes: %zu\n", (size_t) MESSAGES * sizeof(struct ring_message));
+    printf("Out of order messages: %zu\n", latency.out_of_order);
+    printf("Syscalls: %zu\n", syscalls);
+    if (ring) {
+        printf("Doorbell wakeups: %zu\n", wakeups);
+    }
+    printf("Latency avg: %.0f ns, max: %lu ns\n",
+           (double) latency.total_ns / (double) MESSAGES, (unsigned long) latency.max_ns);
+    printf("Elapsed (first send to last receive): %.6f s\n", seconds);
+    if (seconds > 0) {
+        printf("Messages/sec: %.0f\n", (double) MESSAGES / seconds);
+        printf("Throughput: %.2f MB/s\n", (double) MESSAGES * sizeof(struct ring_message) / seconds / 1e6);
+    }
+
+    // Close descriptors
+    if (ring) {
+        close(doorbell_file_descriptor);
+        close(memory_file_descriptor);
+    }
+
+    // Close sockets
+    close(client_file_descriptor);
+    close(socket_file_descriptor);
+
+    // Clean memory
+    free(bootstrap);
+
+    // Remove socket
+    unlink(SOCKET_PATH);
+
+    return 0;
+}
@@ -0,0 +1,285 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <time.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdalign.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+#define F_UNIX 0
+// Count of slots in ring, power of two
+#define RING_SLOTS 4096
+// Size of one message, timestamp and sequence included
+#define MESSAGE_SIZE 64
+// Count of messages to send
+#define MESSAGES 1000000
+// Size of bootstrap message, fixed because messages of socket transport follow it on stream
+#define BOOTSTRAP_SIZE 16
+#define SOCKET_PATH "/tmp/SENDER"
+#define TARGET_SOCKET_PATH "/tmp/RECEIVER"
+
+// Shared header of ring, every index on its own cache line
+struct ring_header {
+    // Next slot to write, written by producer
+    alignas(64) atomic_uint_least64_t head;
+    // Next slot to read, written by consumer
+    alignas(64) atomic_uint_least64_t tail;
+    // Consumer waits on eventfd, producer rings doorbell only then
+    alignas(64) atomic_int sleeping;
+};
+
+struct ring_message {
+    uint64_t sequence;
+    uint64_t sent_ns;
+    char payload[MESSAGE_SIZE - 2 * sizeof(uint64_t)];
+};
+
+uint64_t now_ns() {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+int send_descriptors(int socket_file_descriptor, const char* text, const int* descriptors, size_t count) {
+    // Set bootstrap message, padded with zeros
+    char bootstrap[BOOTSTRAP_SIZE] = {0};
+    strncpy(bootstrap, text, BOOTSTRAP_SIZE - 1);
+
+    // Declaration and assign input/output vector
+    struct iovec iov = { .iov_base = bootstrap, .iov_len = BOOTSTRAP_SIZE };
+    // Declaration and assign message header
+    struct msghdr message = { .msg_iov = &iov, .msg_iovlen = 1 };
+
+    // Set control buffer, aligned for cmsghdr
+    union {
+        char buffer[CMSG_SPACE(sizeof(int) * 2)];
+        struct cmsghdr align;
+    } control = {0};
+
+    if (count != 0) {
+        message.msg_control = control.buffer;
+        message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+        memcpy(CMSG_DATA(cmsg), descriptors, sizeof(int) * count);
+    }
+
+    if (sendmsg(socket_file_descriptor, &message, 0) == -1) {
+        perror("\n\nsendmsg");
+        return -1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Declaration and assign transport, usage: sender [ring|socket]
+    int ring = 1;
+    if (argc > 1 && strcmp(argv[1], "socket") == 0) {
+        ring = 0;
+    } else if (argc > 1 && strcmp(argv[1], "ring") != 0) {
+        fprintf(stderr, "Usage: %s [ring|socket]\n", argv[0]);
+        return 1;
+    }
+
+    // Remove socket
+    unlink(SOCKET_PATH);
+
+    // Declaration and assign socket descriptor
+    int socket_file_descriptor = -1;
+    // Declaration and assign ring memory and doorbell descriptors
+    int memory_file_descriptor = -1, doorbell_file_descriptor = -1;
+
+    // Declaration and assign statistics
+    size_t doorbells = 0, full_waits = 0;
+
+    // Declaration and assign socket address unix
+    struct sockaddr_un socket_address = {0};
+    // Declaration and assign target socket address unix
+    struct sockaddr_un target_socket_address = {0};
+    // Declaration and assign message
+    struct ring_message ring_message = {0};
+
+    // Clean buffer
+    memset(&socket_address, 0, sizeof(socket_address));
+    memset(&target_socket_address, 0, sizeof(target_socket_address));
+    memset(ring_message.payload, 'x', sizeof(ring_message.payload));
+
+    // Create socket
+    socket_file_descriptor = socket(AF_UNIX, SOCK_STREAM, F_UNIX);
+    if (socket_file_descriptor == -1) {
+        perror("\n\nsocket");
+        return 1;
+    }
+
+    // Set socket socket address
+    socket_address.sun_family = PF_UNIX;
+    strcpy(socket_address.sun_path, SOCKET_PATH);
+
+    // Bind socket to socket address
+    if (bind(socket_file_descriptor, (struct sockaddr *) &socket_address, sizeof(socket_address)) == -1) {
+        perror("\n\nbind");
+        return 1;
+    }
+
+    // Set target socket address
+    target_socket_address.sun_family = PF_UNIX;
+    strcpy(target_socket_address.sun_path, TARGET_SOCKET_PATH);
+
+    // Connect to socket
+    if (connect(
+            socket_file_descriptor, (struct sockaddr *) &target_socket_address, sizeof(target_socket_address)
+    ) == -1) {
+        perror("\n\nconnect");
+        return 1;
+    }
+
+    uint64_t start_ns = 0;
+
+    if (!ring) {
+        // Bootstrap without descriptors, messages follow on socket
+        if (send_descriptors(socket_file_descriptor, "socket", NULL, 0) == -1) {
+            return 1;
+        }
+
+        start_ns = now_ns();
+
+        for (uint64_t i = 0; i < MESSAGES; i++) {
+            ring_message.sequence = i; ring_message.sent_ns = now_ns();
+
+            if (send(socket_file_descriptor, &ring_message, sizeof(ring_message), 0) == -1) {
+                perror("\n\nsend");
+                return 1;
+            }
+        }
+    } else {
+        // Declaration and assign size of shared memory
+        size_t memory_size = sizeof(struct ring_header) + (size_t) RING_SLOTS * sizeof(struct ring_message);
+
+        // Create ring memory
+        memory_file_descriptor = memfd_create("ring", MFD_CLOEXEC);
+        if (memory_file_descriptor == -1) {
+            perror("\n\nmemfd_create");
+            return 1;
+        }
+        if (ftruncate(memory_file_descriptor, (off_t) memory_size) == -1) {
+            perror("\n\nftruncate");
+            return 1;
+        }
+
+        // Create doorbell
+        doorbell_file_descriptor = eventfd(0, EFD_CLOEXEC);
+        if (doorbell_file_descriptor == -1) {
+            perror("\n\neventfd");
+            return 1;
+        }
+
+        // Map ring, zero filled by ftruncate
+        void *memory = mmap(NULL, memory_size, PROT_READ | PROT_WRITE, MAP_SHARED, memory_file_descriptor, 0);
+        if (memory == MAP_FAILED) {
+            perror("\n\nmmap");
+            return 1;
+        }
+
+        struct ring_header *header = memory;
+        struct ring_message *slots = (struct ring_message *) (header + 1);
+
+        // Pass ring and doorbell once, socket is not used for data after that
+        const int descriptors[2] = { memory_file_descriptor, doorbell_file_descriptor };
+        if (send_descriptors(socket_file_descriptor, "ring", descriptors, 2) == -1) {
+            return 1;
+        }
+
+        start_ns = now_ns();
+
+        // Declaration and assign producer copy of indexes
+        uint64_t head = 0, tail = 0;
+
+        for (uint64_t i = 0; i < MESSAGES; i++) {
+            // Ring is full, wait consumer
+            if (head - tail == RING_SLOTS) {
+                tail = atomic_load_explicit(&header->tail, memory_order_acquire);
+                if (head - tail == RING_SLOTS) {
+                    ++full_waits;
+                }
+                while (head - tail == RING_SLOTS) {
+                    sched_yield();
+                    tail = atomic_load_explicit(&header->tail, memory_order_acquire);
+                }
+            }
+
+            ring_message.sequence = i; ring_message.sent_ns = now_ns();
+            slots[head & (RING_SLOTS - 1)] = ring_message;
+
+            // Publish slot, then check consumer, pairs with fence of consumer
+            atomic_store_explicit(&header->head, ++head, memory_order_release);
+            atomic_thread_fence(memory_order_seq_cst);
+
+            // Clear flag, so one sleep of consumer costs one doorbell
+            if (atomic_load_explicit(&header->sleeping, memory_order_relaxed)
+                && atomic_exchange_explicit(&header->sleeping, 0, memory_order_relaxed)) {
+                uint64_t value = 1;
+                if (write(doorbell_file_descriptor, &value, sizeof(value)) == -1) {
+                    perror("\n\nwrite");
+                    return 1;
+                }
+                ++doorbells;
+            }
+        }
+
+        munmap(memory, memory_size);
+    }
+
+    double seconds = (double) (now_ns() - start_ns) / 1e9;
+
+    printf("Transport: %s\n", ring ? "ring" : "socket");
+    printf("Sent messages: %d\n", MESSAGES);
+    printf("Sent bytes: %zu\n", (size_t) MESSAGES * sizeof(ring_message));
+    if (ring) {
+        printf("Doorbells: %zu\n", doorbells);
+        printf("Ring full waits: %zu\n", full_waits);
+    }
+    printf("Elapsed: %.6f s\n", seconds);
+    if (seconds > 0) {
+        printf("Messages/sec: %.0f\n", (double) MESSAGES / seconds);
+    }
+
+    // Close descriptors
+    if (ring) {
+        close(doorbell_file_descriptor);
+        close(memory_file_descriptor);
+    }
+
+    // Close socket
+    close(socket_file_descriptor);
+
+    // Remove socket
+    unlink(SOCKET_PATH);
+
+    return 0;
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "monitor.h"
+#include "histogram.h"
+
+// Set by signal handler to stop monitor
+static volatile sig_atomic_t monitor_running = 1;
+
+static void monitor_stop(int signal_number) {
+    (void) signal_number;
+    monitor_running = 0;
+}
+
+static uint64_t monitor_now_ns(void) {
+    struct timespec time = {0};
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000ULL + (uint64_t) time.tv_nsec;
+}
+
+// Time in socket queue, from stamp of kernel to return of recvmsg, both are CLOCK_REALTIME
+static void monitor_record(struct histogram* latencies, const struct timespec* timestamp,
+                           const struct timespec* received_time) {
+    int64_t latency = (int64_t) (received_time->tv_sec - timestamp->tv_sec) * 1000000000LL
+                      + (received_time->tv_nsec - timestamp->tv_nsec);
+
+    // Clock may step back between stamp and now
+    histogram_record(latencies, latency > 0 ? (uint64_t) latency : 0);
+}
+
+int monitor_latencies(int file_descriptor, struct msghdr* message, monitor_stamp stamp) {
+    // Declaration and assign histograms of interval and of whole run
+    struct histogram *interval = histogram_create();
+    struct histogram *total = histogram_create();
+    // Declaration and assign signal action, without SA_RESTART receive returns on SIGINT
+    struct sigaction action = { .sa_handler = monitor_stop };
+    // Declaration and assign type of socket, empty datagram is a message and not end
+    int type = 0;
+    socklen_t type_size = sizeof(type);
+
+    // Declaration and assign result, failed receive still reports stamps taken before it
+    int result = 0;
+
+    // Kernel shrinks both lengths on every receive
+    size_t control_size = message->msg_controllen;
+    socklen_t name_size = message->msg_namelen;
+
+    if (interval == NULL || total == NULL) {
+        perror("\n\nhistogram_create");
+        free(interval);
+        free(total);
+        return -1;
+    }
+
+    if (getsockopt(file_descriptor, SOL_SOCKET, SO_TYPE, &type, &type_size) == -1) {
+        perror("\n\ngetsockopt");
+        free(interval);
+        free(total);
+        return -1;
+    }
+
+    sigaction(SIGINT, &action, NULL);
+
+    printf("Monitor time in socket queue from kernel stamp to receive, stop with SIGINT\n");
+
+    uint64_t report_ns = monitor_now_ns() + (uint64_t) MONITOR_INTERVAL_MS * 1000000ULL;
+
+    while (monitor_running) {
+        message->msg_controllen = control_size;
+        message->msg_namelen = name_size;
+
+        ssize_t received = recvmsg(file_descriptor, message, 0);
+
+        // Time of receive is taken once right after return, before any processing of message
+        struct timespec received_time = {0};
+        clock_gettime(CLOCK_REALTIME, &received_time);
+
+        if (received == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("\n\nrecvmsg");
+            result = -1;
+            break;
+        }
+
+        // End of stream or of connection of seqpacket
+        if (received == 0 && type != SOCK_DGRAM) {
+            break;
+        }
+
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(message); cmsg != NULL; cmsg = CMSG_NXTHDR(message, cmsg)) {
+            struct timespec timestamp = {0};
+
+            if (stamp(cmsg, &timestamp) == 0) {
+                monitor_record(interval, &timestamp, &received_time);
+            }
+        }
+
+        // Report of interval, then it goes to histogram of whole run
+        if (monitor_now_ns() >= report_ns) {
+            histogram_print(interval, "Latency of interval (us)", 1e3, stdout);
+
+            uint64_t backlog_ns = histogram_percentile(interval, 99.0);
+            if (backlog_ns > (uint64_t) MONITOR_BACKLOG_ALERT_US * 1000ULL) {
+                printf("Backlog: p99 %.3f us is above %d us, consumer falls behind\n",
+                       (double) backlog_ns / 1e3, MONITOR_BACKLOG_ALERT_US);
+            }
+
+            histogram_merge(total, interval);
+            histogram_reset(interval);
+            report_ns = monitor_now_ns() + (uint64_t) MONITOR_INTERVAL_MS * 1000000ULL;
+        }
+    }
+
+    histogram_merge(total, interval);
+    histogram_print(total, "Latency (us)", 1e3, stdout);
+
+    if (histogram_export(total, MONITOR_LATENCY_FILE, 1e3) == -1) {
+        perror("\n\nhistogram_export");
+    } else {
+        printf("Percentile distribution: %s\n", MONITOR_LATENCY_FILE);
+    }
+
+    // Clean memory
+    free(interval);
+    free(total);
+
+    return result;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MONITOR_H
+#define MONITOR_H
+
+#include <time.h>
+#include <sys/socket.h>
+
+// Monitor reports latency of interval this often, histogram of whole run goes to file
+#define MONITOR_INTERVAL_MS 1000
+#define MONITOR_LATENCY_FILE "/tmp/RECEIVER_LATENCY.hgrm"
+// Messages of interval wait in socket queue longer than this at p99, consumer falls behind
+#define MONITOR_BACKLOG_ALERT_US 1000
+
+// Kernel stamp of control message in CLOCK_REALTIME, -1 when message carries no such stamp
+typedef int (*monitor_stamp)(const struct cmsghdr* cmsg, struct timespec* timestamp);
+
+// Receive until end or SIGINT, time in socket queue of every stamp goes to histogram, report every interval.
+// Message is reused by every receive, its buffers must stay valid until return. Returns -1 on error.
+int monitor_latencies(int file_descriptor, struct msghdr* message, monitor_stamp stamp);
+
+#endif // MONITOR_H
@@ -0,0 +1,86 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "time_format.h"
+
+// Offset of seconds in prefix "YYYY-MM-DD HH:MM:SS"
+#define SECOND_OFFSET 17
+
+static void write_digits(char* output, unsigned long value, int digits) {
+    for (int i = digits - 1; i >= 0; i--) {
+        output[i] = (char) ('0' + value % 10);
+        value /= 10;
+    }
+}
+
+void time_format_init(struct time_format* format) {
+    tzset();
+
+    // No second maps to -1 minute start, first format fills cache
+    format->second = -1;
+    format->minute_start = -1;
+    memset(format->prefix, 0, sizeof(format->prefix));
+}
+
+// Zone offset changes only on minute boundary, within cached minute only seconds are rendered
+static void time_format_refresh(struct time_format* format, time_t second) {
+    if (format->minute_start != -1 && second >= format->minute_start && second - format->minute_start < 60) {
+        write_digits(format->prefix + SECOND_OFFSET, (unsigned long) (second - format->minute_start), 2);
+        format->second = second;
+        return;
+    }
+
+    // Declaration and assign broken-down time, reentrant call keeps zone read by time_format_init
+    struct tm time_info = {0};
+    if (localtime_r(&second, &time_info) == NULL) {
+        memset(&time_info, 0, sizeof(time_info));
+    }
+
+    write_digits(format->prefix, (unsigned long) (time_info.tm_year + 1900), 4);
+    format->prefix[4] = '-';
+    write_digits(format->prefix + 5, (unsigned long) (time_info.tm_mon + 1), 2);
+    format->prefix[7] = '-';
+    write_digits(format->prefix + 8, (unsigned long) time_info.tm_mday, 2);
+    format->prefix[10] = ' ';
+    write_digits(format->prefix + 11, (unsigned long) time_info.tm_hour, 2);
+    format->prefix[13] = ':';
+    write_digits(format->prefix + 14, (unsigned long) time_info.tm_min, 2);
+    format->prefix[16] = ':';
+    write_digits(format->prefix + SECOND_OFFSET, (unsigned long) time_info.tm_sec, 2);
+
+    format->second = second;
+    // Leap second of tm_sec 60 does not exist in time_t, next second starts new minute
+    format->minute_start = time_info.tm_sec < 60 ? second - time_info.tm_sec : -1;
+}
+
+size_t time_format_timespec(struct time_format* format, const struct timespec* timestamp,
+                            char* buffer, size_t buffer_size) {
+    if (buffer_size < TIME_FORMAT_SIZE) {
+        return 0;
+    }
+
+    if (timestamp->tv_sec != format->second) {
+        time_format_refresh(format, timestamp->tv_sec);
+    }
+
+    memcpy(buffer, format->prefix, TIME_FORMAT_PREFIX_SIZE);
+    buffer[TIME_FORMAT_PREFIX_SIZE] = '.';
+    write_digits(buffer + TIME_FORMAT_PREFIX_SIZE + 1, (unsigned long) timestamp->tv_nsec % 1000000000UL, 9);
+    buffer[TIME_FORMAT_SIZE - 1] = '\0';
+
+    return TIME_FORMAT_SIZE - 1;
+}
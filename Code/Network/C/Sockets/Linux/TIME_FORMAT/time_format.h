@@ -0,0 +1,42 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIME_FORMAT_H
+#define TIME_FORMAT_H
+
+#include <time.h>
+#include <stddef.h>
+
+// Length of "YYYY-MM-DD HH:MM:SS", prefix is rendered once per second
+#define TIME_FORMAT_PREFIX_SIZE 19
+// Length of "YYYY-MM-DD HH:MM:SS.nnnnnnnnn" with terminating zero
+#define TIME_FORMAT_SIZE (TIME_FORMAT_PREFIX_SIZE + 11)
+
+// Cache of local time of last second, one formatter for each thread which formats
+struct time_format {
+    time_t second;
+    time_t minute_start;
+    char prefix[TIME_FORMAT_PREFIX_SIZE];
+};
+
+// Empty cache, zone of process is read here once and not on every format
+void time_format_init(struct time_format* format);
+
+// Write local time with nanoseconds into buffer of at least TIME_FORMAT_SIZE, without heap and libc formatting,
+// return length without terminating zero or 0 if buffer is too small
+size_t time_format_timespec(struct time_format* format, const struct timespec* timestamp,
+                            char* buffer, size_t buffer_size);
+
+#endif // TIME_FORMAT_H
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "uring.h"
+
+int uring_setup(struct uring* ring, unsigned entries, unsigned cq_entries) {
+    // Declaration and assign parameters of instance
+    struct io_uring_params params = {
+            .flags = cq_entries != 0 ? IORING_SETUP_CQSIZE : 0,
+            .cq_entries = cq_entries
+    };
+
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = (int) syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd == -1) {
+        return -1;
+    }
+
+    // Submission and completion rings share one mapping since 5.4
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        close(ring->fd);
+        errno = ENOSYS;
+        return -1;
+    }
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    // Rings are touched on every operation, populate them now instead of faults on first use
+    ring->ring_size = sq_size > cq_size ? sq_size : cq_size;
+    ring->ring = mmap(NULL, ring->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQ_RING);
+    if (ring->ring == MAP_FAILED) {
+        close(ring->fd);
+        return -1;
+    }
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        munmap(ring->ring, ring->ring_size);
+        close(ring->fd);
+        return -1;
+    }
+
+    char *base = ring->ring;
+
+    ring->sq_head = (unsigned *) (base + params.sq_off.head);
+    ring->sq_tail = (unsigned *) (base + params.sq_off.tail);
+    ring->sq_mask = (unsigned *) (base + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (base + params.sq_off.array);
+    ring->cq_head = (unsigned *) (base + params.cq_off.head);
+    ring->cq_tail = (unsigned *) (base + params.cq_off.tail);
+    ring->cq_mask = (unsigned *) (base + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (base + params.cq_off.cqes);
+    ring->sqe_tail = *ring->sq_tail;
+    ring->sq_entries = params.sq_entries;
+    ring->cq_entries = params.cq_entries;
+    ring->features = params.features;
+
+    return 0;
+}
+
+void uring_close(struct uring* ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    munmap(ring->ring, ring->ring_size);
+    close(ring->fd);
+}
+
+int uring_enter(struct uring* ring, unsigned wait, int timeout_ms) {
+    struct __kernel_timespec timeout = {
+            .tv_sec = timeout_ms / 1000,
+            .tv_nsec = (long long) (timeout_ms % 1000) * 1000000
+    };
+    struct io_uring_getevents_arg argument = { .ts = (uint64_t) (uintptr_t) &timeout };
+
+    unsigned flags = (wait ? IORING_ENTER_GETEVENTS : 0) | (wait && timeout_ms >= 0 ? IORING_ENTER_EXT_ARG : 0);
+
+    // Kernel must see filled entries before new tail
+    __atomic_store_n(ring->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+
+    // Entries not consumed by kernel yet, repeated call after EINTR submits only them
+    unsigned submit = ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+    ++ring->syscalls;
+
+    long result = flags & IORING_ENTER_EXT_ARG
+                  ? syscall(__NR_io_uring_enter, ring->fd, submit, wait, flags, &argument, sizeof(argument))
+                  : syscall(__NR_io_uring_enter, ring->fd, submit, wait, flags, NULL, 0);
+
+    return result == -1 ? -1 : 0;
+}
+
+struct io_uring_sqe* uring_get_sqe(struct uring* ring) {
+    // Full submission ring goes to kernel without wait
+    while (ring->sqe_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) == ring->sq_entries) {
+        if (uring_enter(ring, 0, -1) == -1 && errno != EINTR) {
+            return NULL;
+        }
+    }
+
+    unsigned slot = ring->sqe_tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[slot];
+
+    ring->sq_array[slot] = slot;
+    ++ring->sqe_tail;
+
+    memset(sqe, 0, sizeof(*sqe));
+
+    return sqe;
+}
+
+int uring_reap(struct uring* ring, struct io_uring_cqe* cqe) {
+    unsigned head = *ring->cq_head;
+
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    *cqe = ring->cqes[head & *ring->cq_mask];
+
+    // Return completion entry to kernel
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+    return 1;
+}
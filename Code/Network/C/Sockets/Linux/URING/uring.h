@@ -0,0 +1,63 @@
+/*
+ * Copyright 2023 Stanislav Mikhailov (xavetar)
+ *
+ * Licensed under the Creative Commons Zero v1.0 Universal (CC0) License.
+ * You may obtain a copy of the License at
+ *
+ *     http://creativecommons.org/publicdomain/zero/1.0/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the CC0 license is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef URING_H
+#define URING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <linux/io_uring.h>
+
+// Mapped rings of io_uring instance, made with system calls only, without liburing
+struct uring {
+    int fd;
+    // Features of instance reported by kernel, IORING_FEAT_*
+    unsigned features;
+    unsigned sqe_tail;
+    unsigned sq_entries;
+    unsigned cq_entries;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *ring;
+    size_t ring_size;
+    size_t sqes_size;
+    // Calls of io_uring_enter made through this instance
+    uint64_t syscalls;
+};
+
+// Map instance with entries of submission ring, cq_entries 0 keeps completion ring of kernel (twice entries)
+int uring_setup(struct uring* ring, unsigned entries, unsigned cq_entries);
+
+void uring_close(struct uring* ring);
+
+// Submit all taken entries and wait for wait completions, timeout_ms < 0 waits forever,
+// timeout needs IORING_FEAT_EXT_ARG and ends with ETIME, EINTR goes to caller and call may be repeated
+int uring_enter(struct uring* ring, unsigned wait, int timeout_ms);
+
+// Take next free submission entry, kernel sees it after uring_enter, full ring is submitted first,
+// NULL with errno of that submission when kernel does not take entries
+struct io_uring_sqe* uring_get_sqe(struct uring* ring);
+
+// Take completion from ring, returns 0 when ring is empty
+int uring_reap(struct uring* ring, struct io_uring_cqe* cqe);
+
+#endif // URING_H